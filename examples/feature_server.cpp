@@ -0,0 +1,34 @@
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+
+#include "go_data_gen/feature_server.hpp"
+
+using namespace go_data_gen;
+
+int main(int argc, char* argv[]) {
+    const bool use_stdio = argc == 2 && std::strcmp(argv[1], "--stdio") == 0;
+    const bool use_socket = argc == 3 && std::strcmp(argv[1], "--socket") == 0;
+    if (!use_stdio && !use_socket) {
+        printf("Usage: %s --socket <path> | --stdio\n", argv[0]);
+        return 1;
+    }
+
+    // A client that disconnects must only end its own connection.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    try {
+        if (use_stdio) {
+            FeatureServer server;
+            server.serve(0, 1);
+        } else {
+            serve_feature_socket(argv[2]);
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
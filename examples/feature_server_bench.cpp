@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "go_data_gen/feature_server.hpp"
+#include "go_data_gen/sgf.hpp"
+
+using namespace go_data_gen;
+
+// Checks that the server rejects malformed boards without creating a session, and that the
+// connection stays usable. Returns false on failure.
+bool check_invalid_boards(const std::string& socket_path) {
+    Board board({9, 9});
+    board.play(Move{Black, false, {4, 4}});
+    const std::string valid = board.serialize();
+    // The first history move follows the 45 bytes of the header, the 2-bit stones and the count.
+    const size_t move_offset = 45 + (9 * 9 + 3) / 4 + 4;
+    std::string out_of_range = valid;
+    out_of_range[move_offset + 2] = 100;
+    out_of_range[move_offset + 3] = 100;
+    std::string bad_color = valid;
+    bad_color[move_offset] = OffBoard;
+
+    FeatureClient client(socket_path);
+    for (const std::string& payload :
+         {valid.substr(0, valid.size() / 2), valid + "x", out_of_range, bad_color}) {
+        try {
+            client.new_game(payload);
+            fprintf(stderr, "Server accepted an invalid board\n");
+            return false;
+        } catch (const std::runtime_error&) {
+        }
+    }
+    const uint32_t session = client.new_game(valid);
+    Board::FeaturePlaneRows rows;
+    Board::FeatureVector scalars;
+    client.get_features(session, White, rows, scalars);
+    client.close_game(session);
+    return rows == board.get_feature_plane_rows(White);
+}
+
+// Load test for feature_server: each client replays games move by move, requesting the features
+// before every move, and checks them against a local board.
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        printf("Usage: %s <socket_path> <num_clients> <sgf_file_path>...\n", argv[0]);
+        return 1;
+    }
+    const std::string socket_path = argv[1];
+    const int num_clients = std::atoi(argv[2]);
+    const std::vector<std::string> paths(argv + 3, argv + argc);
+    if (!check_invalid_boards(socket_path)) {
+        return 1;
+    }
+
+    std::vector<std::vector<double>> latencies(num_clients);
+    std::atomic<size_t> next_path{0};
+    std::atomic<long> num_mismatches{0};
+    std::atomic<bool> failed{false};
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (int i = 0; i < num_clients; ++i) {
+        clients.emplace_back([&, i] {
+            try {
+                FeatureClient client(socket_path);
+                Board::FeaturePlaneRows rows;
+                Board::FeatureVector scalars;
+                for (size_t p = next_path++; p < paths.size(); p = next_path++) {
+                    Board board;
+                    std::vector<Move> moves;
+                    float result;
+                    if (!load_sgf(paths[p], board, moves, result)) {
+                        continue;
+                    }
+                    const uint32_t session = client.new_game(board);
+                    for (const Move& move : moves) {
+                        const auto t0 = std::chrono::steady_clock::now();
+                        client.get_features(session, move.color, rows, scalars);
+                        const auto t1 = std::chrono::steady_clock::now();
+                        latencies[i].push_back(std::chrono::duration<double>(t1 - t0).count());
+                        if (rows != board.get_feature_plane_rows(move.color) ||
+                            scalars != board.get_feature_scalars(move.color)) {
+                            ++num_mismatches;
+                        }
+                        const PackedMove packed = PackedMove::from_move(move);
+                        client.play(session, &packed, 1);
+                        board.play(move);
+                    }
+                    client.close_game(session);
+                }
+            } catch (const std::exception& e) {
+                fprintf(stderr, "Client %d failed: %s\n", i, e.what());
+                failed = true;
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> all;
+    for (const auto& client_latencies : latencies) {
+        all.insert(all.end(), client_latencies.begin(), client_latencies.end());
+    }
+    std::sort(all.begin(), all.end());
+    const auto percentile = [&](double q) {
+        return all.empty() ? 0.0 : all[std::min(all.size() - 1, size_t(q * all.size()))] * 1e6;
+    };
+    printf("positions: %zu in %.3f s (%.0f per second), mismatches: %ld\n", all.size(), seconds,
+           all.size() / seconds, num_mismatches.load());
+    printf("get_features latency: p50 %.1f us, p90 %.1f us, p99 %.1f us\n", percentile(0.5),
+           percentile(0.9), percentile(0.99));
+    return failed || num_mismatches > 0 ? 1 : 0;
+}
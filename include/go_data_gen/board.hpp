@@ -1,8 +1,10 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <functional>
-#include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "rules.hpp"
@@ -16,6 +18,16 @@ public:
     static constexpr int padding = 1;
     static constexpr int data_size = max_board_size + 2 * padding;
 
+    // Points in data coordinates (including padding) are indexed as y * data_size + x, so the
+    // neighbors of a point are at fixed offsets and every on-board point has all four of them.
+    using Point = uint16_t;
+    static constexpr int num_points = data_size * data_size;
+    static constexpr Point to_point(int x, int y) { return static_cast<Point>(y * data_size + x); }
+    static constexpr int point_x(Point point) { return point % data_size; }
+    static constexpr int point_y(Point point) { return point / data_size; }
+    // Left, right, up, down.
+    static constexpr std::array<int, 4> neighbor_offsets{-1, 1, -data_size, data_size};
+
     Board(Vec2 board_size = {19, 19}, float komi = 7.5, Ruleset ruleset = TrompTaylorRules,
           int num_handicap_stones = 0);
 
@@ -26,6 +38,10 @@ public:
     int num_handicap_stones;
 
     void reset();
+    // Same as assigning a new Board, but keeps the storage of the board for reuse.
+    void reset(Vec2 board_size, float komi, Ruleset ruleset, int num_handicap_stones);
+    // Bytes of the board object and the heap storage that it holds.
+    size_t get_memory_usage() const;
     // Used for handicap and setup moves.
     // Does not handle legality checks or captures.
     // Does not influence (super)ko.
@@ -38,34 +54,240 @@ public:
     MoveLegality get_move_legality(Move move);
     bool is_legal(Move move);
 
+    // Outcome of a move, derived from the groups next to it without playing it.
+    struct MoveLookahead {
+        int num_liberties;  // Of the group of the move afterwards, counted up to num_lib_planes.
+        int num_captures;   // Number of captured stones.
+        bool is_atari_escape;  // An own group next to the move is in atari and gets out of it.
+    };
+    // Only meaningful for legal moves that are not passes.
+    MoveLookahead get_move_lookahead(Move move);
+
     void play(Move move);
+    // Plays `num_moves` moves in order. Throws on the first move that is illegal or off the board,
+    // in which case the moves before it remain played.
+    void play_moves(const PackedMove* moves, size_t num_moves);
+
+    // Groups of the current position as row-major [height, width] arrays over the board size,
+    // read from the union-find state. Stones of a group share an id, counted from 0 in row-major
+    // order of the groups' first stones, and hold the size and liberties of the group. Empty points
+    // have id -1, size 0 and 0 liberties. Values above 127 are stored as 127.
+    void get_group_data(int8_t* group_ids, int8_t* group_sizes, int8_t* liberty_counts);
+    // Plays `moves` like `play_moves` and writes the group data of each position of the game to
+    // [num_moves + 1, height, width] arrays: the current position first, then the position after
+    // each move.
+    void get_game_group_data(const PackedMove* moves, size_t num_moves, int8_t* group_ids,
+                             int8_t* group_sizes, int8_t* liberty_counts);
 
-    static constexpr int num_feature_planes = 18;
+    // Zobrist hashes of the stones under each of the 8 dihedral symmetries, including setup stones.
+    // Symmetry index bit 0 transposes, bit 1 flips horizontally, bit 2 flips vertically.
+    static constexpr int num_symmetries = 8;
+    const std::array<uint64_t, num_symmetries>& get_symmetric_hashes() const {
+        return symmetric_zobrist;
+    }
+    // Hash that is identical for all symmetric variants of a position.
+    // Also covers side to move, komi, ruleset and board size.
+    uint64_t get_canonical_hash(Color to_play) const;
+
+    static constexpr int num_feature_planes = 25;
     static constexpr int legal_move_plane_index = 0;
     static constexpr int on_board_plane_index = 1;
+    static constexpr int own_stone_plane_index = 2;
+    static constexpr int opponent_stone_plane_index = 3;
+    static constexpr int ko_plane_index = 4;
+    // Groups with 1, 2, 3 and 4+ liberties, first of the own and then of the opponent's color.
+    static constexpr int lib_plane_index = 5;
+    static constexpr int num_lib_planes = 4;
+    // Last moves played, most recent first.
+    static constexpr int history_plane_index = lib_plane_index + 2 * num_lib_planes;
+    static constexpr int num_history_planes = 5;
+    // One-ply lookahead, set for legal moves only: the group of the move would have 1, 2, 3 and
+    // 4+ liberties, the move captures, the move is self-atari (one liberty without capturing) and
+    // the move saves an own group in atari (two or more liberties afterwards).
+    static constexpr int lookahead_plane_index = history_plane_index + num_history_planes;
+    static constexpr int lookahead_lib_plane_index = lookahead_plane_index;
+    static constexpr int capture_plane_index = lookahead_lib_plane_index + num_lib_planes;
+    static constexpr int self_atari_plane_index = capture_plane_index + 1;
+    static constexpr int atari_escape_plane_index = self_atari_plane_index + 1;
+    static constexpr int num_lookahead_planes =
+        atari_escape_plane_index + 1 - lookahead_plane_index;
+    static_assert(num_feature_planes == lookahead_plane_index + num_lookahead_planes);
 
     using StackedFeaturePlanes =
         std::array<std::array<std::array<float, num_feature_planes>, data_size>, data_size>;
     StackedFeaturePlanes get_feature_planes(Color to_play);
 
+    // The same feature planes as bit rows: bit x of rows[y][c] is the value of plane c at (x, y).
+    // See feature_expand.hpp for expanding them into other tensor layouts.
+    using FeaturePlaneRows = std::array<std::array<uint32_t, num_feature_planes>, data_size>;
+    FeaturePlaneRows get_feature_plane_rows(Color to_play);
+
     static constexpr int num_feature_scalars = 8;
     using FeatureVector = std::array<float, num_feature_scalars>;
     FeatureVector get_feature_scalars(Color to_play);
 
+    // Planes and scalars together, with a single legality pass for both.
+    // See feature_set.hpp for other combinations of features.
+    void get_features(Color to_play, FeaturePlaneRows& rows, FeatureVector& scalars);
+
+    // Legal and ko-forbidden points of `to_play`, and the lookahead planes of the legal points,
+    // as bit rows like the feature planes.
+    struct MoveRows {
+        std::array<uint32_t, data_size> legal;
+        std::array<uint32_t, data_size> ko;
+        std::array<std::array<uint32_t, num_lookahead_planes>, data_size> lookahead;
+    };
+    // Computes all of them in one pass over the empty points. The lookahead is left empty unless
+    // `with_lookahead` is set.
+    void get_move_rows(Color to_play, bool with_lookahead, MoveRows& rows);
+
+    // Feature planes are binary, so they can be stored with one bit per entry.
+    // Bits are in the same (y, x, plane) order as `StackedFeaturePlanes`.
+    static constexpr int num_feature_plane_bits = data_size * data_size * num_feature_planes;
+    using PackedFeaturePlanes = std::array<uint64_t, (num_feature_plane_bits + 63) / 64>;
+    static PackedFeaturePlanes pack_feature_planes(const StackedFeaturePlanes& planes);
+    static void unpack_feature_planes(const PackedFeaturePlanes& packed,
+                                      StackedFeaturePlanes& planes);
+
+    // Hash of everything that the feature planes and scalars depend on: stones, side to move,
+    // recent moves, pass and capture state, ko history, komi and ruleset.
+    uint64_t get_feature_key(Color to_play) const;
+
+    // Stones of the current and previous positions, kept in a ring buffer of bit rows that is
+    // updated by `play`. Rows are indexed by color - Black, then y, and bit x is the point (x, y).
+    static constexpr int max_stone_history = 16;
+    using StoneRows = std::array<std::array<uint32_t, data_size>, 2>;
+    // Planes of own and opponent stones of the current and the previous `num_positions - 1`
+    // positions, as bit rows with layout [data_size][2 * num_positions]. Plane 2t holds the own
+    // stones t moves ago and plane 2t + 1 those of the opponent. Positions from before the board
+    // was set up are empty.
+    void get_stone_history_rows(Color to_play, int num_positions, uint32_t* rows) const;
+
+    // Everything needed to restore a position besides the board size, komi and ruleset.
+    // Groups, liberties and symmetric hashes are rebuilt from the stones on restore.
+    struct State {
+        std::vector<Color> stones;  // Row-major over the board size.
+        std::vector<Move> history;
+        uint64_t zobrist;
+        std::vector<uint64_t> zobrist_history;
+        Color first_player_to_pass;
+        int num_captures;
+        int num_setup_stones;
+        // Previous positions, most recent first. At most max_stone_history - 1 of them.
+        std::vector<StoneRows> stone_history;
+    };
+    State get_state() const;
+    void set_state(const State& state);
+
+    // Compact binary form of the full board, including board size, komi, ruleset and handicap.
+    // The format is versioned and, like zobrist hashes, tied to the current zobrist seed.
+    std::string serialize() const;
+    // Replaces the board with a serialized one. Throws if the data is invalid or was written with
+    // a different format version or zobrist seed.
+    void deserialize(std::string_view data);
+
     void print(std::function<bool(int x, int y)> highlight_fn = [](int, int) { return false; });
     void print_group_sizes();
     void print_liberties();
 
 private:
-    char board[data_size][data_size];
+    friend class IncrementalFeaturizer;
+    friend struct FeatureGenerator;
+
+    // Color of each point. The padding and points beyond the board size are OffBoard.
+    alignas(64) std::array<char, num_points> board;
     Vec2 board_size;
+    // The points of the board for the current size, row by row.
+    std::array<Point, max_board_size * max_board_size> on_board_points;
+    int num_on_board_points;
+
+    // Set of points as a bitset, iterated in increasing order. Unlike a node-based set it never
+    // allocates, and merging two sets is a few word operations.
+    class PointSet {
+    public:
+        class Iterator {
+        public:
+            Iterator(const uint64_t* _words, int _index)
+                : words{_words}, index{_index}, bits{index < num_words ? words[index] : 0} {
+                skip_empty_words();
+            }
+            Point operator*() const { return index * 64 + __builtin_ctzll(bits); }
+            Iterator& operator++() {
+                bits &= bits - 1;
+                skip_empty_words();
+                return *this;
+            }
+            bool operator!=(const Iterator& other) const {
+                return index != other.index || bits != other.bits;
+            }
+
+        private:
+            const uint64_t* words;
+            int index;
+            uint64_t bits;  // Points of word `index` that were not visited yet.
 
-    Vec2 parent[data_size][data_size];
-    std::vector<Vec2> group[data_size][data_size];
-    std::set<Vec2> liberties[data_size][data_size];
+            void skip_empty_words() {
+                while (bits == 0 && index < num_words && ++index < num_words) {
+                    bits = words[index];
+                }
+            }
+        };
 
-    Vec2 find(Vec2 coord);
-    void unite(Vec2 a, Vec2 b);
+        Iterator begin() const { return Iterator(words.data(), 0); }
+        Iterator end() const { return Iterator(words.data(), num_words); }
+        int size() const { return count; }
+        bool empty() const { return count == 0; }
+        void clear() {
+            words.fill(0);
+            count = 0;
+        }
+        void insert(Point point) {
+            const uint64_t bit = uint64_t{1} << (point % 64);
+            count += (words[point / 64] & bit) == 0;
+            words[point / 64] |= bit;
+        }
+        void erase(Point point) {
+            const uint64_t bit = uint64_t{1} << (point % 64);
+            count -= (words[point / 64] & bit) != 0;
+            words[point / 64] &= ~bit;
+        }
+        void merge(const PointSet& other) {
+            count = 0;
+            for (int i = 0; i < num_words; ++i) {
+                words[i] |= other.words[i];
+                count += __builtin_popcountll(words[i]);
+            }
+        }
+
+    private:
+        static constexpr int num_words = (num_points + 63) / 64;
+        std::array<uint64_t, num_words> words{};
+        int count = 0;  // Cached, since sizes are queried far more often than sets change.
+    };
+
+    // Union-find forest of the stones. The root of each group holds its stones and liberties.
+    alignas(64) std::array<Point, num_points> parent;
+    std::array<std::vector<Point>, num_points> group;
+    std::array<PointSet, num_points> liberties;
+
+    Point find(Point point);
+    void unite(Point a, Point b);
+
+    // Empty points and distinct groups next to an empty point, from the view of `color`. This is
+    // all that legality and lookahead need besides the groups' liberties.
+    struct NeighborGroups {
+        int num_empty = 0;
+        int num_own = 0;
+        int num_opp = 0;
+        std::array<Point, 4> empty;
+        std::array<Point, 4> own_roots;
+        std::array<Point, 4> opp_roots;
+    };
+    NeighborGroups get_neighbor_groups(Point point, Color color);
+    MoveLegality get_move_legality(Point point, Color color, const NeighborGroups& neighbors);
+    MoveLookahead get_move_lookahead(Point point, Color color, const NeighborGroups& neighbors);
+    // Sets `bit` in the lookahead planes `rows[0..num_lookahead_planes)` as given by `lookahead`.
+    static void set_lookahead_bits(const MoveLookahead& lookahead, uint32_t bit, uint32_t* rows);
 
     std::vector<Move> history;
     Color first_player_to_pass;
@@ -74,7 +296,21 @@ private:
 
     uint64_t zobrist;
     std::vector<uint64_t> zobrist_history;
-    bool any_ko_move(Color to_play);
+    std::array<uint64_t, num_symmetries> symmetric_zobrist;
+
+    // The current position is at `stone_history_head`.
+    std::array<StoneRows, max_stone_history> stone_history;
+    int stone_history_head;
+    int num_stone_history;
+    void toggle_symmetric_zobrist(Point point, Color color);
+    // Plays `move` if it is valid and legal, otherwise throws an error naming the move `index`.
+    void play_checked(Move move, size_t index);
+    uint64_t get_context_hash(Color to_play) const;
+    // Legality of a move of `color` that results in the stones hashed by `new_zobrist`.
+    MoveLegality get_ko_legality(uint64_t new_zobrist, Color color) const;
+    // Hash of the position after a move of `color`, as stored in `zobrist_history`.
+    uint64_t get_history_hash(uint64_t new_zobrist, Color color) const;
+    static uint64_t get_stone_hash(Point point, Color color);
 };
 
 }  // namespace go_data_gen
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "go_data_gen/board.hpp"
+
+namespace go_data_gen {
+
+// N boards that are stepped in lockstep, e.g. for batched self-play inference.
+// Moves, side to move and all outputs are stored as arrays over the batch, so a whole step is a
+// single call. Work is spread over `num_threads` threads (0 = one per hardware thread).
+class BoardBatch {
+public:
+    // Moves are encoded as `y * Board::max_board_size + x`, or one of the special values below.
+    static constexpr int pass_move = -1;
+    static constexpr int no_move = -2;  // Leaves the board unchanged, e.g. for finished games.
+
+    // Output layouts, all C-contiguous:
+    //   feature planes: [N, Board::num_feature_planes, Board::data_size, Board::data_size]
+    //   feature scalars: [N, Board::num_feature_scalars]
+    //   legal masks: [N, Board::data_size, Board::data_size]
+    static constexpr int feature_planes_size =
+        Board::num_feature_planes * Board::data_size * Board::data_size;
+    static constexpr int legal_mask_size = Board::data_size * Board::data_size;
+
+    BoardBatch(int num_boards, Vec2 board_size = {19, 19}, float komi = 7.5,
+               Ruleset ruleset = TrompTaylorRules, int num_threads = 0);
+
+    int size() const { return static_cast<int>(boards.size()); }
+    // Accessors of a single board throw std::out_of_range if `i` is not in [0, size()).
+    Board& board(int i) {
+        check_index(i);
+        return boards[i];
+    }
+    Color to_play(int i) const {
+        check_index(i);
+        return to_play_colors[i];
+    }
+    const std::vector<Color>& get_to_play() const { return to_play_colors; }
+
+    void reset();
+    void reset(int i);
+
+    // Plays `moves[i]` for the side to move on board i. All moves are checked before any is played,
+    // so if one is off the board or illegal, this throws and leaves every board unchanged.
+    void play(const int* moves);
+
+    // Any of the output pointers may be null to skip that output.
+    void get_features(float* feature_planes, float* feature_scalars, uint8_t* legal_masks);
+
+    // `play` followed by `get_features`, with the same all-or-nothing guarantee. Outputs are not
+    // written if a move is rejected.
+    void step(const int* moves, float* feature_planes, float* feature_scalars,
+              uint8_t* legal_masks);
+
+private:
+    std::vector<Board> boards;
+    std::vector<Color> to_play_colors;
+    int num_threads;
+    // Moves of the current play or step, checked for legality. Empty color for `no_move`.
+    std::vector<Move> checked_moves;
+
+    void check_index(int i) const;
+    // Converts and checks all moves into `checked_moves`. Throws on the first bad move.
+    void check_moves(const int* moves);
+    void check_move(int i, int move);
+    void play_one(int i);
+    void get_features_one(int i, float* feature_planes, float* feature_scalars,
+                          uint8_t* legal_masks);
+};
+
+}  // namespace go_data_gen
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "go_data_gen/board.hpp"
+
+namespace go_data_gen {
+
+// Groups positions by board size and emits each batch cropped to the board plus its padding,
+// instead of the full data_size x data_size grid. A 9x9 batch is then 11x11 instead of 21x21.
+class BucketedBatcher {
+public:
+    // All arrays are C-contiguous, with height = board_size.y + 2 * Board::padding and
+    // width = board_size.x + 2 * Board::padding.
+    struct Batch {
+        Vec2 board_size;
+        int height;
+        int width;
+        int size = 0;
+        std::vector<float> feature_planes;   // [size, Board::num_feature_planes, height, width]
+        std::vector<float> feature_scalars;  // [size, Board::num_feature_scalars]
+        std::vector<uint8_t> masks;          // [size, height, width], 1 for on-board points.
+        std::vector<int> moves;  // Index into the flattened height x width grid, or -1 for a pass.
+        std::vector<float> results;
+    };
+
+    explicit BucketedBatcher(int batch_size);
+
+    // Adds the position of `board` with `to_play` to move, with `move` and `result` as targets.
+    void add(Board& board, Color to_play, const Move& move, float result);
+    void add(Vec2 board_size, const Board::FeaturePlaneRows& rows,
+             const Board::FeatureVector& scalars, const Move& move, float result);
+
+    // Moves all partially filled batches to the ready queue, e.g. at the end of an epoch.
+    void flush();
+
+    size_t num_ready() const { return ready.size(); }
+    // Takes the oldest full batch. Returns false if none is ready.
+    bool pop(Batch& batch);
+
+private:
+    int batch_size;
+    std::map<std::pair<int, int>, Batch> buckets;
+    std::deque<Batch> ready;
+};
+
+}  // namespace go_data_gen
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "go_data_gen/board.hpp"
+
+namespace go_data_gen {
+
+// 64-bit FNV-1a. Stable across platforms, builds and runs, unlike std::hash.
+uint64_t stable_hash(std::string_view data);
+// Shard of an input, based on the stable hash of its name.
+int get_shard_index(std::string_view input, int num_shards);
+
+// Fixed-size training example written by `featurize_sgf`, so shard files can be memory-mapped as
+// arrays of records.
+struct PositionRecord {
+    Board::PackedFeaturePlanes planes;  // See Board::pack_feature_planes.
+    Board::FeatureVector scalars;
+    int16_t move;  // y * Board::max_board_size + x, or -1 for a pass.
+    int8_t to_play;
+    int8_t padding[1];
+    float result;  // From Black's perspective, as returned by load_sgf.
+};
+static_assert(sizeof(PositionRecord) ==
+              sizeof(Board::PackedFeaturePlanes) + sizeof(Board::FeatureVector) + 8);
+// Bump whenever the records change without changing their size, e.g. when features are reordered
+// or other games are skipped. Part of the CorpusJob fingerprint, together with the record size.
+static constexpr uint32_t position_record_version = 2;
+
+// Appends one PositionRecord per training position of the SGF file at `path` to `output`.
+// Games that GameLoader does not load with status Ok produce no records.
+void featurize_sgf(const std::string& path, std::string& output);
+
+// Converts a list of inputs into `num_shards` output files that can be resumed after a crash.
+// Each input is assigned to a shard by its stable hash, so independent processes or nodes can
+// split the shards among themselves without coordination. A shard's output is the concatenation
+// of `convert(input)` over its inputs in sorted order.
+//
+// Files in `output_dir`, for shard i of n:
+//   shard-<i>-of-<n>.bin          the finished output
+//   shard-<i>-of-<n>.bin.partial  output while the shard is in progress
+//   shard-<i>-of-<n>.progress     inputs and bytes completed as of the last checkpoint
+// A restarted job truncates the partial output to the last checkpoint and continues from there,
+// so the finished output is byte-identical to that of an uninterrupted run. Progress written for
+// other inputs or another record format is never resumed, and such shards are not complete.
+class CorpusJob {
+public:
+    // Called with the full input path. Must be deterministic and thread-safe.
+    using ConvertFn = std::function<void(const std::string& input_path, std::string& output)>;
+
+    // Inputs are named relative to `input_root`, so that their shard does not depend on where the
+    // corpus is mounted. Progress is checkpointed every `checkpoint_interval` inputs.
+    CorpusJob(const std::vector<std::string>& inputs, const std::string& input_root,
+              const std::string& output_dir, int num_shards, int checkpoint_interval = 64);
+
+    int num_shards() const { return static_cast<int>(shard_inputs.size()); }
+    const std::vector<std::string>& get_shard_inputs(int shard) const {
+        return shard_inputs[shard];
+    }
+    std::string get_shard_path(int shard) const;
+    bool is_shard_complete(int shard) const;
+
+    // Runs the given shards in parallel, one thread per shard, skipping completed work.
+    void run(const std::vector<int>& shards, const ConvertFn& convert, int num_threads = 0);
+
+private:
+    struct Progress {
+        uint64_t fingerprint = 0;
+        uint64_t num_inputs_done = 0;
+        uint64_t num_bytes = 0;
+        bool complete = false;
+    };
+
+    std::vector<std::vector<std::string>> shard_inputs;
+    std::string input_root;
+    std::string output_dir;
+    int checkpoint_interval;
+
+    uint64_t get_fingerprint(int shard) const;
+    std::string get_progress_path(int shard) const;
+    Progress read_progress(int shard) const;
+    void write_progress(int shard, const Progress& progress) const;
+    void run_shard(int shard, const ConvertFn& convert);
+};
+
+}  // namespace go_data_gen
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "go_data_gen/board.hpp"
+
+namespace go_data_gen {
+
+// Size-bounded, thread-safe LRU cache of feature planes and scalars, keyed by
+// `Board::get_feature_key`. Planes are stored bit-packed.
+class FeatureCache {
+public:
+    explicit FeatureCache(size_t capacity);
+
+    FeatureCache(const FeatureCache&) = delete;
+    FeatureCache& operator=(const FeatureCache&) = delete;
+
+    // Returns the cached features of `board` if present. Otherwise computes and stores them.
+    void get_features(Board& board, Color to_play, Board::StackedFeaturePlanes& planes,
+                      Board::FeatureVector& scalars);
+
+    bool lookup(uint64_t key, Board::StackedFeaturePlanes& planes, Board::FeatureVector& scalars);
+    void insert(uint64_t key, const Board::StackedFeaturePlanes& planes,
+                const Board::FeatureVector& scalars);
+
+    uint64_t hits() const { return num_hits.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return num_misses.load(std::memory_order_relaxed); }
+    double hit_rate() const;
+    size_t size() const;
+    void clear();
+
+private:
+    static constexpr int num_shards = 16;
+
+    struct Entry {
+        uint64_t key;
+        Board::PackedFeaturePlanes planes;
+        Board::FeatureVector scalars;
+    };
+
+    // Most recently used entries are at the front of the list.
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> entries;
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    };
+
+    size_t capacity_per_shard;
+    std::array<Shard, num_shards> shards;
+    std::atomic<uint64_t> num_hits{0};
+    std::atomic<uint64_t> num_misses{0};
+
+    static int shard_index(uint64_t key) { return static_cast<int>(key >> 60); }
+};
+
+}  // namespace go_data_gen
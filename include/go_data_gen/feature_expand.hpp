@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+namespace go_data_gen {
+
+// Kernels that expand binary feature planes, stored as bit rows, into dense tensors of 0/1 values.
+// `rows` has layout [height][num_planes], and bit x of a row is the value at column x, so
+// width <= 32. SSE2 and AVX2 versions are selected at runtime, with a scalar fallback.
+
+enum class SimdLevel {
+    Scalar = 0,
+    SSE2 = 1,
+    AVX2 = 2,
+};
+
+// Highest level supported by the CPU.
+SimdLevel get_supported_simd_level();
+SimdLevel get_simd_level();
+// Restricts the kernels to `level`, e.g. for benchmarks. Clamped to the supported level.
+void set_simd_level(SimdLevel level);
+
+// Output layout [height][width][num_planes].
+void expand_rows_hwc(const uint32_t* rows, int height, int width, int num_planes, float* out);
+// Output layout [num_planes][height][width].
+void expand_rows_chw(const uint32_t* rows, int height, int width, int num_planes, float* out);
+void expand_rows_chw(const uint32_t* rows, int height, int width, int num_planes, uint8_t* out);
+
+}  // namespace go_data_gen
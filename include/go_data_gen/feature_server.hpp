@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "go_data_gen/board.hpp"
+
+namespace go_data_gen {
+
+// Local featurization service for inference, so that a game front-end keeps one board per game
+// and only sends new moves, instead of replaying the game for every position.
+//
+// Messages in both directions are framed as a u32 payload size followed by the payload, in native
+// byte order. Requests start with a u8 FeatureRequest and a u32 session id, responses with a u8
+// FeatureStatus. Error responses carry a message. Request payloads and Ok response payloads:
+//   NewGame      Board::serialize() of the initial board  ->  u32 session id
+//   Play         u32 count, PackedMove[count]             ->  (empty)
+//   GetFeatures  u8 color to play                         ->  Board::FeaturePlaneRows,
+//                                                             Board::FeatureVector
+//   CloseGame    (empty)                                  ->  (empty)
+// The session id of NewGame is ignored. The legal move mask is the legal move plane of the rows.
+// An illegal move fails a Play request, and the moves before it remain played.
+//
+// Writing to a connection that the other side closed raises SIGPIPE unless it is ignored.
+enum class FeatureRequest : uint8_t {
+    NewGame = 1,
+    Play = 2,
+    GetFeatures = 3,
+    CloseGame = 4,
+};
+
+enum class FeatureStatus : uint8_t {
+    Ok = 0,
+    Error = 1,
+};
+
+// Larger frames are rejected, which ends the connection.
+constexpr uint32_t max_feature_message_size = 1 << 24;
+
+// Game sessions of one connection. Not thread-safe.
+class FeatureServer {
+public:
+    // Handles one request payload and writes the response payload.
+    void handle(std::string_view request, std::string& response);
+
+    // Serves framed requests from `in_fd` and writes the responses to `out_fd` until the input
+    // ends. Throws on I/O errors and malformed frames.
+    void serve(int in_fd, int out_fd);
+
+    size_t num_sessions() const { return sessions.size(); }
+
+private:
+    std::unordered_map<uint32_t, Board> sessions;
+    uint32_t next_session_id = 1;
+};
+
+// Listens on the Unix socket `path` and serves every connection on its own thread, with its own
+// sessions. Does not return unless the socket fails.
+void serve_feature_socket(const std::string& path);
+
+// Client of a FeatureServer. Throws std::runtime_error on I/O errors and error responses.
+class FeatureClient {
+public:
+    // Connects to a server listening on the Unix socket `socket_path`.
+    explicit FeatureClient(const std::string& socket_path);
+    // Talks to a server over existing file descriptors, e.g. the pipes of a child process running
+    // the server in stdin/stdout mode. The descriptors are not closed by the client.
+    FeatureClient(int in_fd, int out_fd);
+    ~FeatureClient();
+
+    FeatureClient(const FeatureClient&) = delete;
+    FeatureClient& operator=(const FeatureClient&) = delete;
+
+    // Starts a game from `board`, which may already have setup stones and moves.
+    uint32_t new_game(const Board& board);
+    // Same, with the board as written by Board::serialize.
+    uint32_t new_game(std::string_view serialized_board);
+    void play(uint32_t session_id, const PackedMove* moves, size_t num_moves);
+    void get_features(uint32_t session_id, Color to_play, Board::FeaturePlaneRows& rows,
+                      Board::FeatureVector& scalars);
+    void close_game(uint32_t session_id);
+
+private:
+    int in_fd;
+    int out_fd;
+    bool owns_fds;
+    std::string request;
+    std::string response;
+
+    void begin_request(FeatureRequest type, uint32_t session_id);
+    // Sends `request` and reads the response. Returns the payload after the status byte.
+    std::string_view call();
+};
+
+}  // namespace go_data_gen
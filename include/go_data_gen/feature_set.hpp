@@ -0,0 +1,231 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "go_data_gen/board.hpp"
+
+namespace go_data_gen {
+
+// Inputs that are shared by all generators of a feature set and computed once per position.
+struct FeatureContext {
+    Board& board;
+    Color to_play;
+    // Only filled if a generator of the set needs it.
+    Board::MoveRows moves;
+};
+
+// Where a generator writes its planes and scalars. Plane i of row y is rows[y * row_stride + i].
+struct FeatureOutput {
+    uint32_t* rows;
+    int row_stride;
+    float* scalars;
+
+    uint32_t& row(int y, int plane) const { return rows[y * row_stride + plane]; }
+};
+
+// Base of all feature generators. A generator is a type with `num_planes` bit planes and
+// `num_scalars` scalars, written by `static void compute(const FeatureContext&, FeatureOutput)`
+// from the perspective of `to_play`. `needs_move_rows` and `needs_lookahead` request the shared
+// legality and lookahead pass. The static helpers give generators read access to the board.
+struct FeatureGenerator {
+    static constexpr int num_planes = 0;
+    static constexpr int num_scalars = 0;
+    static constexpr bool needs_move_rows = false;
+    static constexpr bool needs_lookahead = false;
+
+    static Color color_at(const Board& board, int x, int y) {
+        return static_cast<Color>(board.board[Board::to_point(x, y)]);
+    }
+    // Liberties of the group at the data coordinate (x, y).
+    static int num_liberties(Board& board, int x, int y) {
+        return board.liberties[board.find(Board::to_point(x, y))].size();
+    }
+    // Stones of the current position, by color - Black.
+    static const Board::StoneRows& stone_rows(const Board& board) {
+        return board.stone_history[board.stone_history_head];
+    }
+    static const std::vector<Move>& history(const Board& board) { return board.history; }
+    static Color first_player_to_pass(const Board& board) { return board.first_player_to_pass; }
+    static int num_captures(const Board& board) { return board.num_captures; }
+    static int num_setup_stones(const Board& board) { return board.num_setup_stones; }
+};
+
+// Generators of the default features, in the order of Board's plane and scalar indices.
+struct LegalMovePlane : FeatureGenerator {
+    static constexpr int num_planes = 1;
+    static constexpr bool needs_move_rows = true;
+    static void compute(const FeatureContext& context, FeatureOutput out);
+};
+struct OnBoardPlane : FeatureGenerator {
+    static constexpr int num_planes = 1;
+    static void compute(const FeatureContext& context, FeatureOutput out);
+};
+// Own stones, then the opponent's.
+struct StonePlanes : FeatureGenerator {
+    static constexpr int num_planes = 2;
+    static void compute(const FeatureContext& context, FeatureOutput out);
+};
+struct KoPlane : FeatureGenerator {
+    static constexpr int num_planes = 1;
+    static constexpr bool needs_move_rows = true;
+    static void compute(const FeatureContext& context, FeatureOutput out);
+};
+// Own groups with 1, 2, 3 and 4+ liberties, then the opponent's.
+struct LibertyPlanes : FeatureGenerator {
+    static constexpr int num_planes = 2 * Board::num_lib_planes;
+    static void compute(const FeatureContext& context, FeatureOutput out);
+};
+// Last moves played, most recent first.
+struct MoveHistoryPlanes : FeatureGenerator {
+    static constexpr int num_planes = Board::num_history_planes;
+    static void compute(const FeatureContext& context, FeatureOutput out);
+};
+// See Board::lookahead_plane_index.
+struct LookaheadPlanes : FeatureGenerator {
+    static constexpr int num_planes = Board::num_lookahead_planes;
+    static constexpr bool needs_move_rows = true;
+    static constexpr bool needs_lookahead = true;
+    static void compute(const FeatureContext& context, FeatureOutput out);
+};
+// Komi and pass bonus for the player to move, divided by 15.
+struct KomiScalar : FeatureGenerator {
+    static constexpr int num_scalars = 1;
+    static void compute(const FeatureContext& context, FeatureOutput out);
+};
+// Whether any move is forbidden by ko or superko.
+struct KoScalar : FeatureGenerator {
+    static constexpr int num_scalars = 1;
+    static constexpr bool needs_move_rows = true;
+    static void compute(const FeatureContext& context, FeatureOutput out);
+};
+// 1 for territory scoring, 0 for area scoring.
+struct ScoringScalar : FeatureGenerator {
+    static constexpr int num_scalars = 1;
+    static void compute(const FeatureContext& context, FeatureOutput out);
+};
+// Captures of the player to move minus those of the opponent, divided by 15.
+struct CaptureScalar : FeatureGenerator {
+    static constexpr int num_scalars = 1;
+    static void compute(const FeatureContext& context, FeatureOutput out);
+};
+// Stones placed so far over the number of points.
+struct GameStageScalar : FeatureGenerator {
+    static constexpr int num_scalars = 1;
+    static void compute(const FeatureContext& context, FeatureOutput out);
+};
+// Whether each of the last 3 moves was a pass.
+struct PassHistoryScalars : FeatureGenerator {
+    static constexpr int num_scalars = 3;
+    static void compute(const FeatureContext& context, FeatureOutput out);
+};
+
+// A list of generators whose planes and scalars are concatenated in order. Sizes and offsets are
+// known at compile time, and only the listed generators run. The legality pass runs at most once,
+// and only if a generator needs it.
+template <typename... Generators>
+class FeatureSet {
+public:
+    static_assert(sizeof...(Generators) > 0);
+
+    static constexpr int num_planes = (0 + ... + Generators::num_planes);
+    static constexpr int num_scalars = (0 + ... + Generators::num_scalars);
+    // Same layout as Board::FeaturePlaneRows.
+    using PlaneRows = std::array<std::array<uint32_t, num_planes>, Board::data_size>;
+    using Scalars = std::array<float, num_scalars>;
+
+    template <typename Generator>
+    static constexpr bool contains = (false || ... || std::is_same_v<Generator, Generators>);
+
+    // Index of the first plane of `Generator`.
+    template <typename Generator>
+    static constexpr int plane_offset() {
+        static_assert(contains<Generator>, "The generator is not part of the feature set");
+        return offset<Generator>(std::array<int, sizeof...(Generators)>{Generators::num_planes...});
+    }
+    // Index of the first scalar of `Generator`.
+    template <typename Generator>
+    static constexpr int scalar_offset() {
+        static_assert(contains<Generator>, "The generator is not part of the feature set");
+        return offset<Generator>(
+            std::array<int, sizeof...(Generators)>{Generators::num_scalars...});
+    }
+
+    static void compute(Board& board, Color to_play, PlaneRows& rows, Scalars& scalars) {
+        FeatureContext context{board, to_play, {}};
+        if constexpr ((false || ... || Generators::needs_move_rows)) {
+            board.get_move_rows(to_play, (false || ... || Generators::needs_lookahead),
+                                context.moves);
+        }
+        rows = {};
+        scalars = {};
+        (Generators::compute(context, FeatureOutput{rows[0].data() + plane_offset<Generators>(),
+                                                    num_planes,
+                                                    scalars.data() + scalar_offset<Generators>()}),
+         ...);
+    }
+
+    static PlaneRows get_plane_rows(Board& board, Color to_play) {
+        static_assert(num_scalars == 0, "Use compute to also get the scalars");
+        PlaneRows rows;
+        Scalars scalars;
+        compute(board, to_play, rows, scalars);
+        return rows;
+    }
+
+    static Scalars get_scalars(Board& board, Color to_play) {
+        static_assert(num_planes == 0, "Use compute to also get the planes");
+        PlaneRows rows;
+        Scalars scalars;
+        compute(board, to_play, rows, scalars);
+        return scalars;
+    }
+
+private:
+    template <typename Generator>
+    static constexpr int offset(const std::array<int, sizeof...(Generators)>& sizes) {
+        constexpr std::array<bool, sizeof...(Generators)> matches{
+            std::is_same_v<Generator, Generators>...};
+        int result = 0;
+        for (size_t i = 0; i < sizes.size() && !matches[i]; ++i) {
+            result += sizes[i];
+        }
+        return result;
+    }
+};
+
+// The planes and scalars of Board::get_feature_plane_rows and Board::get_feature_scalars.
+// TODO: pass-alive areas, ladder status.
+using DefaultFeaturePlanes = FeatureSet<LegalMovePlane, OnBoardPlane, StonePlanes, KoPlane,
+                                        LibertyPlanes, MoveHistoryPlanes, LookaheadPlanes>;
+using DefaultFeatureScalars = FeatureSet<KomiScalar, KoScalar, ScoringScalar, CaptureScalar,
+                                         GameStageScalar, PassHistoryScalars>;
+using DefaultFeatures =
+    FeatureSet<LegalMovePlane, OnBoardPlane, StonePlanes, KoPlane, LibertyPlanes,
+               MoveHistoryPlanes, LookaheadPlanes, KomiScalar, KoScalar, ScoringScalar,
+               CaptureScalar, GameStageScalar, PassHistoryScalars>;
+
+// Stones, liberties and recent moves only. Skips the legality pass, which is most of the cost.
+// Bound in Python as Board.get_stone_features.
+using StoneFeatures =
+    FeatureSet<OnBoardPlane, StonePlanes, LibertyPlanes, MoveHistoryPlanes, KomiScalar>;
+
+static_assert(DefaultFeaturePlanes::num_planes == Board::num_feature_planes);
+static_assert(DefaultFeaturePlanes::plane_offset<LegalMovePlane>() ==
+              Board::legal_move_plane_index);
+static_assert(DefaultFeaturePlanes::plane_offset<OnBoardPlane>() == Board::on_board_plane_index);
+static_assert(DefaultFeaturePlanes::plane_offset<StonePlanes>() == Board::own_stone_plane_index);
+static_assert(Board::opponent_stone_plane_index == Board::own_stone_plane_index + 1);
+static_assert(DefaultFeaturePlanes::plane_offset<KoPlane>() == Board::ko_plane_index);
+static_assert(DefaultFeaturePlanes::plane_offset<LibertyPlanes>() == Board::lib_plane_index);
+static_assert(DefaultFeaturePlanes::plane_offset<MoveHistoryPlanes>() ==
+              Board::history_plane_index);
+static_assert(DefaultFeaturePlanes::plane_offset<LookaheadPlanes>() ==
+              Board::lookahead_plane_index);
+static_assert(DefaultFeatureScalars::num_scalars == Board::num_feature_scalars);
+static_assert(std::is_same_v<DefaultFeatures::PlaneRows, Board::FeaturePlaneRows>);
+static_assert(std::is_same_v<DefaultFeatures::Scalars, Board::FeatureVector>);
+
+}  // namespace go_data_gen
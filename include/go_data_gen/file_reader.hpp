@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace go_data_gen {
+
+enum class IoBackend {
+    Auto = 0,     // io_uring if the kernel supports it, threads otherwise.
+    IoUring = 1,  // Linux io_uring, with open, read and close of many files in flight at once.
+    Threads = 2,  // Blocking reads on a pool of threads.
+};
+
+// Reads many small files with overlapping I/O in the background and hands their contents to any
+// number of consumer threads through a bounded queue, in completion order.
+class FileReader {
+public:
+    struct File {
+        size_t index;  // Index into `paths`.
+        std::string content;
+        int error;  // errno value, 0 on success.
+        bool is_prefix = false;  // Rejected by the prefix filter, `content` is the first read.
+    };
+
+    // Called with the first read of each file that is larger than it, on a reader thread. Returns
+    // false to stop reading the file. Must be thread-safe.
+    using PrefixFilter = std::function<bool(std::string_view prefix)>;
+
+    // At most `queue_depth` files are read at once and at most `capacity` files are read or waiting
+    // for a consumer, which bounds the memory use. The threads backend uses `queue_depth` threads.
+    explicit FileReader(std::vector<std::string> paths, int queue_depth = 64, int capacity = 256,
+                        IoBackend backend = IoBackend::Auto, PrefixFilter prefix_filter = nullptr);
+    ~FileReader();
+
+    FileReader(const FileReader&) = delete;
+    FileReader& operator=(const FileReader&) = delete;
+
+    // Waits for the next file. Returns false once all files were returned. Thread-safe.
+    bool next(File& file);
+
+    IoBackend get_backend() const { return backend; }
+    // True if this build and the running kernel support the io_uring backend.
+    static bool is_io_uring_available();
+
+private:
+    class Ring;
+
+    std::vector<std::string> paths;
+    int queue_depth;
+    int capacity;
+    IoBackend backend;
+    PrefixFilter prefix_filter;
+
+    std::mutex mutex;
+    std::condition_variable ready_cv;  // A file was completed, or all files were.
+    std::condition_variable space_cv;  // A consumer took a file, or the reader is stopping.
+    std::deque<File> ready;
+    size_t num_reserved = 0;  // Files that are being read or are in `ready`.
+    size_t num_returned = 0;
+    bool stopping = false;
+
+    std::atomic<size_t> next_index{0};
+    std::vector<std::thread> threads;
+
+    // Blocks until a file may be started. Returns false when stopping.
+    bool reserve();
+    void complete(File file);
+
+    void run_threads();
+    void run_io_uring(Ring& ring);
+};
+
+}  // namespace go_data_gen
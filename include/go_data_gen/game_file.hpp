@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "go_data_gen/board.hpp"
+
+namespace go_data_gen {
+
+// Compact binary container of games with random access to their positions.
+// Moves are stored as 2-byte codes. Every `checkpoint_interval` moves, a snapshot of the board is
+// stored, so any position is restored from a nearby checkpoint by replaying fewer than
+// `checkpoint_interval + Board::max_stone_history` moves, which also restores the stone history.
+// Snapshots include zobrist hashes, so files can only be read with the zobrist seed they were
+// written with.
+
+// A single game, decoded from a game file.
+struct GameRecord {
+    Vec2 board_size;
+    float komi;
+    Ruleset ruleset;
+    int num_handicap_stones;
+    float result;
+    // Moves played from the starting position, e.g. those after `startTurnIdx` of an SGF.
+    std::vector<Move> moves;
+
+    int checkpoint_interval;
+    // Moves of the starting position's history, which precede `moves`.
+    std::vector<Move> start_history;
+    // Stone history of the starting position, packed like the checkpoint stones.
+    std::vector<std::vector<uint8_t>> start_stone_history;
+    int num_setup_stones;
+    struct Checkpoint {
+        std::vector<uint8_t> stones;  // 2 bits per point, row-major.
+        int num_captures;
+        Color first_player_to_pass;
+        uint64_t zobrist;
+        uint32_t zobrist_history_size;
+        uint32_t hashes_end;  // The zobrist history is the last entries of hashes[0, hashes_end).
+    };
+    std::vector<Checkpoint> checkpoints;
+    std::vector<uint64_t> hashes;
+
+    // Restores the position before `moves[move_index]`, or after the last move if `move_index`
+    // equals the number of moves.
+    void get_position(int move_index, Board& board) const;
+};
+
+class GameWriter {
+public:
+    explicit GameWriter(const std::string& path, int checkpoint_interval = 16);
+    ~GameWriter();
+
+    GameWriter(const GameWriter&) = delete;
+    GameWriter& operator=(const GameWriter&) = delete;
+
+    // Stores the game that starts at `board` and continues with `moves`, which must be legal.
+    void add_game(const Board& board, const std::vector<Move>& moves, float result);
+    // Writes the game table. Called by the destructor if needed.
+    void close();
+
+private:
+    std::ofstream out;
+    std::string path;
+    int checkpoint_interval;
+    std::vector<uint64_t> game_offsets;
+};
+
+class GameReader {
+public:
+    explicit GameReader(const std::string& path);
+
+    size_t num_games() const { return game_offsets.size(); }
+    GameRecord read_game(size_t index);
+
+private:
+    std::ifstream in;
+    std::string path;
+    std::vector<uint64_t> game_offsets;
+    uint64_t table_offset;
+};
+
+}  // namespace go_data_gen
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "go_data_gen/board.hpp"
+
+namespace go_data_gen {
+
+// Keeps the feature planes of a board up to date as moves are played, instead of recomputing all
+// of them for every position. Each move only touches the placed and captured stones, the liberty
+// planes of the groups next to them, the legality and lookahead of the points around them and the
+// history planes. The planes are always from the perspective of the side to move.
+//
+// All changes to the board must go through `play`. Call `refresh` after changing it otherwise.
+class IncrementalFeaturizer {
+public:
+    // A single entry of the feature planes that changed, in data coordinates (including padding).
+    struct Change {
+        uint8_t y;
+        uint8_t x;
+        uint8_t plane;
+        uint8_t value;
+    };
+
+    // `board` must outlive the featurizer.
+    explicit IncrementalFeaturizer(Board& board, Color to_play = Black);
+
+    // Recomputes all features from the board.
+    void refresh();
+
+    // Plays `move` on the board and updates the features for the opponent of `move.color`.
+    void play(Move move);
+
+    Color get_to_play() const { return to_play; }
+    const Board::FeaturePlaneRows& get_feature_plane_rows() const { return rows; }
+    const Board::StackedFeaturePlanes& get_feature_planes() const { return planes; }
+    // Same as Board::get_feature_scalars, but the ko scalar comes from the maintained ko rows
+    // instead of a full legality pass.
+    Board::FeatureVector get_feature_scalars() const;
+    // Entries of the feature planes that changed with the last `play`, in row-major order.
+    const std::vector<Change>& get_last_changes() const { return changes; }
+
+private:
+    using BitRows = std::array<uint32_t, Board::data_size>;
+
+    Board& board;
+    Color to_play;
+
+    // State in absolute colors, indexed by `color - Black`.
+    BitRows on_board;
+    std::array<BitRows, 2> stones;
+    std::array<std::array<BitRows, Board::num_lib_planes>, 2> libs;
+    std::array<BitRows, 2> legal;
+    std::array<BitRows, 2> ko;
+    // Lookahead planes of the legal moves, as rows of [num_lookahead_planes] like the feature rows.
+    using LookaheadRows = std::array<std::array<uint32_t, Board::num_lookahead_planes>,
+                                     Board::data_size>;
+    std::array<LookaheadRows, 2> lookahead;
+    // Points whose legality may have changed since it was last computed for that color.
+    std::array<BitRows, 2> dirty;
+    std::array<bool, 2> legality_valid;
+    // Positions of `Board::zobrist_history`, for superko checks in constant time.
+    std::unordered_set<uint64_t> previous_positions;
+    size_t num_synced_positions = 0;
+
+    Board::FeaturePlaneRows rows;
+    Board::StackedFeaturePlanes planes;
+    std::vector<Change> changes;
+
+    void update_groups(const BitRows& changed);
+    void update_legality();
+    void sync_previous_positions();
+    Board::FeaturePlaneRows assemble_rows() const;
+};
+
+}  // namespace go_data_gen
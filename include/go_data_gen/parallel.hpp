@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace go_data_gen {
+
+inline int resolve_num_threads(int num_threads) {
+    return num_threads > 0 ? num_threads
+                           : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+// Calls `func(i)` for every i in [0, n) using up to `num_threads` threads (0 = one per hardware
+// thread). Indices are handed out dynamically and the calling thread takes part.
+// The first exception thrown by `func` is rethrown after all threads have finished.
+template <typename Func>
+void parallel_for(size_t n, int num_threads, Func&& func) {
+    num_threads = static_cast<int>(std::min<size_t>(resolve_num_threads(num_threads), n));
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < n; ++i) {
+            func(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&]() {
+        for (size_t i = next++; i < n; i = next++) {
+            try {
+                func(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next = n;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+}  // namespace go_data_gen
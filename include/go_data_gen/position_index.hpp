@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace go_data_gen {
+
+// Concurrent set of position hashes (e.g. from `Board::get_canonical_hash`) with occurrence counts.
+// Used to drop or down-weight positions that have already been emitted.
+// At most `max_entries` entries are held in memory. When a shard is full, its entries are written
+// to a sorted run file in `spill_dir` and remain visible to lookups. Run files are only opened
+// while they are read, and a shard's runs are merged into one once there are `max_runs_per_shard`
+// of them. Every spilled entry keeps 2 bytes of Bloom filter in memory, so memory still grows with
+// the number of spilled entries, just more slowly. Without a spill directory, the shard is cleared
+// instead, so older positions are forgotten and memory is bounded.
+class PositionIndex {
+public:
+    explicit PositionIndex(size_t max_entries = size_t{1} << 24, const std::string& spill_dir = "");
+    ~PositionIndex();
+
+    PositionIndex(const PositionIndex&) = delete;
+    PositionIndex& operator=(const PositionIndex&) = delete;
+
+    // Records one occurrence of `hash`. Returns the number of previous occurrences.
+    uint32_t insert(uint64_t hash);
+    // Returns the number of recorded occurrences of `hash`.
+    uint32_t count(uint64_t hash) const;
+
+    // Number of distinct hashes currently held in memory.
+    size_t size() const;
+    // Number of entries written to spill files.
+    size_t num_spilled() const;
+    void clear();
+
+private:
+    static constexpr int num_shards = 64;
+    static constexpr int bloom_bits_per_entry = 16;
+    static constexpr int max_runs_per_shard = 8;
+
+    // Sorted (hash, count) pairs on disk, guarded by a Bloom filter kept in memory.
+    struct SpillRun {
+        std::string path;
+        long pid;  // Process that wrote the file, and the only one that removes it.
+        std::vector<uint64_t> bloom;
+        size_t num_entries;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, uint32_t> counts;
+        std::vector<std::unique_ptr<SpillRun>> runs;
+        int num_runs_created = 0;
+    };
+
+    size_t max_entries_per_shard;
+    std::string spill_dir;
+    uint64_t instance_id;
+    std::array<Shard, num_shards> shards;
+
+    static int shard_index(uint64_t hash) { return static_cast<int>(hash >> 58); }
+    uint32_t count_spilled(const Shard& shard, uint64_t hash) const;
+    void spill(Shard& shard, int shard_idx);
+    // Creates an empty run with a Bloom filter sized for `num_entries`.
+    std::unique_ptr<SpillRun> new_run(Shard& shard, int shard_idx, size_t num_entries) const;
+    void merge_runs(Shard& shard, int shard_idx);
+    static void remove_run(const SpillRun& run);
+};
+
+}  // namespace go_data_gen
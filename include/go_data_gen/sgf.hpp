@@ -1,13 +1,172 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "go_data_gen/board.hpp"
+#include "go_data_gen/sgf_index.hpp"
 
 namespace go_data_gen {
 
 // Return false if the file is in the encore phase, true otherwise
 bool load_sgf(const std::string& file_path, Board& board, std::vector<Move>& moves, float& result);
+// Same as `load_sgf`, but parses SGF content that is already in memory.
+bool load_sgf_from_buffer(std::string_view content, Board& board, std::vector<Move>& moves,
+                          float& result);
+
+// Decides from the root node properties of a game whether to load it.
+using SgfFilter = std::function<bool(const SgfMetadata& metadata)>;
+// Same as `load_sgf`, but reads only the root node first. Returns false before any move is parsed
+// or a board is built if the root node is incomplete, the game began in the encore phase, or
+// `filter` rejects it. Only the first few KB of rejected files are read.
+bool load_sgf_filtered(const std::string& file_path, const SgfFilter& filter, Board& board,
+                       std::vector<Move>& moves, float& result);
+bool load_sgf_from_buffer_filtered(std::string_view content, const SgfFilter& filter, Board& board,
+                                   std::vector<Move>& moves, float& result);
+
+enum class SgfStatus {
+    Ok = 0,
+    // Began in the encore phase, rejected by the filter, or no moves after the start turn.
+    Skipped = 1,
+    ReadError = 2,
+    // Incomplete game tree, a missing or invalid SZ, KM, RU or RE property, or no startTurnIdx.
+    InvalidProperty = 3,
+    // Illegal move, a point outside of the board, or two moves of the same color in a row. Board
+    // requires alternating colors, which load_sgf only asserts, so such games are rejected here.
+    IllegalMove = 4,
+};
+
+// Same as `load_sgf_filtered`, but never throws or prints. Failures are returned as a status, with
+// a short description in `reason`. Stricter than `load_sgf` about move order, see IllegalMove.
+SgfStatus try_load_sgf(const std::string& file_path, const SgfFilter& filter, Board& board,
+                       std::vector<Move>& moves, float& result, std::string& reason);
+SgfStatus try_load_sgf_from_buffer(std::string_view content, const SgfFilter& filter, Board& board,
+                                   std::vector<Move>& moves, float& result, std::string& reason);
+
+// Loads games one after another like `try_load_sgf`, into buffers that are reset in place: the file
+// content, the root properties, the setup stones and moves, and the board. Once the buffers have
+// grown to the largest game seen, loading a valid game does no heap allocation, unlike the
+// functions above, which build a fresh board and buffers per game. Use one loader per thread.
+class GameLoader {
+public:
+    SgfStatus load(const std::string& file_path, const SgfFilter& filter = nullptr);
+    SgfStatus load_from_buffer(std::string_view content, const SgfFilter& filter = nullptr);
+
+    // Starting position and moves of the last game that loaded with status Ok, valid until the next
+    // load. The board may be played on.
+    Board& get_board() { return board; }
+    const std::vector<Move>& get_moves() const { return moves; }
+    float get_result() const { return result; }
+    // Description of the last failure, empty after status Ok.
+    const std::string& get_reason() const { return reason; }
+
+    // Bytes held by the loader, including its buffers. Buffers only grow, so this is also the peak,
+    // reached by the largest games loaded so far.
+    size_t get_peak_memory_usage() const;
+
+private:
+    Board board;
+    std::string buffer;  // File content.
+    SgfMetadata metadata;
+    std::vector<Move> setup_moves;
+    std::vector<Move> moves;
+    float result = 0.0f;
+    std::string reason;
+};
+
+struct SgfLoadResult {
+    SgfStatus status = SgfStatus::ReadError;
+    std::string reason;  // Empty if the status is Ok.
+    // Only set if the status is Ok.
+    std::string board;  // Starting position, see Board::serialize.
+    std::vector<PackedMove> moves;
+    float result = 0.0f;
+};
+
+// Loads the given files with `num_threads` parser threads (0 = one per hardware thread) while a
+// FileReader reads ahead. Results are in the order of `paths`. A bad file only affects its own
+// entry. As with `load_sgf_filtered`, only the first few KB of rejected files are read. `filter` is
+// called from several threads.
+std::vector<SgfLoadResult> load_sgf_many(const std::vector<std::string>& paths,
+                                         const SgfFilter& filter = nullptr, int num_threads = 0);
+
+// Rewrites the first game of `content` as minimal canonical SGF. Only SZ, HA, KM, RU, RE, the
+// startTurnIdx and encore flags, the final setup stones and the moves that the loaders use are
+// kept, and every move is checked for legality. Games that are skipped by the loaders, e.g. because
+// they began in the encore phase, are kept as well.
+SgfStatus compact_sgf(std::string_view content, std::string& output, std::string& reason);
+
+struct SgfCompactResult {
+    SgfStatus status = SgfStatus::ReadError;  // ReadError also covers failed writes.
+    std::string reason;
+    uint64_t input_bytes = 0;
+    uint64_t output_bytes = 0;  // 0 if nothing was written.
+};
+
+// Compacts `inputs`, named relative to `input_root`, into the same relative paths below
+// `output_dir`, using `num_threads` threads (0 = one per hardware thread). Files that fail are not
+// written. Results are in the order of `inputs`.
+std::vector<SgfCompactResult> compact_sgf_files(const std::vector<std::string>& inputs,
+                                                const std::string& input_root,
+                                                const std::string& output_dir,
+                                                int num_threads = 0);
+
+// Parse a KataGo-style rules string such as "koPOSITIONALscoreAREAtaxNONEsui1".
+Ruleset parse_ruleset(std::string_view rules_str);
+
+// Calls `func(node_index, property_id, value)` for every property value of the SGF game tree
+// starting at the first '(' at or after `pos` in `content`. Nodes are numbered in file order, so
+// the root node has index 0. Variations are visited but not distinguished.
+// `func` returns false to stop early.
+// Returns the position after the last character consumed, or std::string_view::npos if no complete
+// game tree was found.
+template <typename Func>
+size_t for_each_sgf_property(std::string_view content, size_t pos, Func&& func) {
+    pos = content.find('(', pos);
+    if (pos == std::string_view::npos) {
+        return std::string_view::npos;
+    }
+
+    int depth = 0;
+    int node_index = -1;
+    std::string_view property_id;
+    while (pos < content.size()) {
+        const char c = content[pos];
+        if (c == '[') {
+            const size_t value_start = ++pos;
+            while (pos < content.size() && content[pos] != ']') {
+                pos += content[pos] == '\\' ? 2 : 1;
+            }
+            if (pos >= content.size()) {
+                return std::string_view::npos;
+            }
+            if (!func(node_index, property_id, content.substr(value_start, pos - value_start))) {
+                return pos + 1;
+            }
+            ++pos;
+        } else if (c >= 'A' && c <= 'Z') {
+            const size_t id_start = pos;
+            while (pos < content.size() && content[pos] >= 'A' && content[pos] <= 'Z') {
+                ++pos;
+            }
+            property_id = content.substr(id_start, pos - id_start);
+        } else {
+            if (c == '(') {
+                ++depth;
+            } else if (c == ')') {
+                if (--depth == 0) {
+                    return pos + 1;
+                }
+            } else if (c == ';') {
+                ++node_index;
+            }
+            ++pos;
+        }
+    }
+    return std::string_view::npos;
+}
 
 }  // namespace go_data_gen
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "go_data_gen/types.hpp"
+
+namespace go_data_gen {
+
+// Metadata of one SGF game, read from the root node without replaying any moves.
+struct SgfMetadata {
+    std::string path;
+    uint64_t offset = 0;  // Byte offset of the game tree within the file.
+    uint64_t length = 0;  // Byte length of the game tree.
+    Vec2 board_size{0, 0};
+    float komi = 0.0f;
+    int num_handicap_stones = 0;
+    std::string rules;   // Raw RU[] value
+    std::string result;  // Raw RE[] value
+    int start_turn_index = -1;  // -1 if the root has no valid startTurnIdx.
+    int num_moves = 0;
+    bool began_in_encore = false;
+    // False if the game tree is incomplete or has no SZ[] property.
+    bool is_valid = false;
+};
+
+// Scan all game trees in `content`. Each game gets its own entry with `path` set to `path`.
+void scan_sgf_metadata(std::string_view content, const std::string& path,
+                       std::vector<SgfMetadata>& entries);
+
+// Reads only the root node of the first game tree in `content`, leaving `num_moves` at 0.
+// Returns false if the root node is incomplete, e.g. because `content` is a prefix of the file.
+bool scan_sgf_root(std::string_view content, SgfMetadata& metadata);
+
+// Scan the given files using `num_threads` threads (0 = one per hardware thread).
+// Files that cannot be read produce a single invalid entry.
+// Entries are returned in the order of `paths`.
+std::vector<SgfMetadata> scan_sgf_files(const std::vector<std::string>& paths, int num_threads = 0);
+
+// Recursively scan all .sgf files below `directory`. Entries are sorted by path.
+std::vector<SgfMetadata> scan_sgf_directory(const std::string& directory, int num_threads = 0);
+
+// Compact binary index of scanned metadata, so later runs can filter and shard a corpus without
+// reopening every file.
+void write_sgf_index(const std::string& index_path, const std::vector<SgfMetadata>& entries);
+std::vector<SgfMetadata> read_sgf_index(const std::string& index_path);
+
+}  // namespace go_data_gen
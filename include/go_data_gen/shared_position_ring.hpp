@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "go_data_gen/board.hpp"
+
+namespace go_data_gen {
+
+// Single-producer, multi-consumer ring buffer of featurized positions in POSIX shared memory, so
+// that generator and trainer processes on one host exchange positions without serialization.
+// Each position is taken by exactly one consumer, which reads it in place and then releases the
+// slot. Publishing and consuming are lock-free; waiting for a free or filled slot polls.
+//
+// A consumer that dies while holding a slot blocks the producer once the ring wraps around.
+class SharedPositionRing {
+public:
+    // One position. Planes are binary, so they are stored as bytes in the CHW layout.
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence;  // Internal: publish and release state of the slot.
+        uint8_t feature_planes[Board::num_feature_planes][Board::data_size][Board::data_size];
+        float feature_scalars[Board::num_feature_scalars];
+        int32_t move;  // y * Board::max_board_size + x, or -1 for a pass.
+        int8_t to_play;
+        float result;
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    // Creates the shared memory object `name` (e.g. "/gdg_positions") with `num_slots` >= 2 slots.
+    // Used by the producer, which removes the name again on destruction.
+    SharedPositionRing(const std::string& name, int num_slots);
+    // Maps an existing ring. Used by consumers.
+    explicit SharedPositionRing(const std::string& name);
+    ~SharedPositionRing();
+
+    SharedPositionRing(const SharedPositionRing&) = delete;
+    SharedPositionRing& operator=(const SharedPositionRing&) = delete;
+
+    int num_slots() const;
+    Slot& slot(int index) { return slots[index]; }
+    // Number of published positions that no consumer has taken yet.
+    uint64_t num_pending() const;
+
+    // Producer: waits for a free slot and returns it for writing, or nullptr on timeout.
+    // A negative timeout waits forever.
+    Slot* begin_write(double timeout_seconds = -1);
+    // Producer: makes the slot returned by begin_write visible to consumers.
+    void publish();
+    // Producer: featurizes the position for `to_play` directly into a slot and publishes it.
+    bool push(Board& board, Color to_play, const Move& move, float result,
+              double timeout_seconds = -1);
+    // Same, with features computed for `to_play` by the caller.
+    bool push(const Board::FeaturePlaneRows& rows, const Board::FeatureVector& scalars,
+              Color to_play, const Move& move, float result, double timeout_seconds = -1);
+    // Producer: no more positions follow. Consumers drain the ring and then get -1.
+    void close();
+
+    // Consumer: waits for a published position and returns its slot index, or -1 on timeout or
+    // once the ring is closed and drained. The slot must be passed to `release` when done.
+    int acquire(double timeout_seconds = -1);
+    void release(int index);
+
+private:
+    struct Header;
+
+    std::string name;
+    bool is_owner;
+    size_t mapping_size = 0;
+    void* mapping = nullptr;
+    Header* header = nullptr;
+    Slot* slots = nullptr;
+    uint64_t write_index = 0;  // Producer only.
+
+    void map(int fd, size_t size);
+};
+
+}  // namespace go_data_gen
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace go_data_gen {
+
+// Streams the regular files of a tar archive without unpacking it to disk.
+// Gzip-compressed archives (.tar.gz / .tgz) are decompressed on the fly if the library was built
+// with zlib. Supports ustar, GNU long names and pax path records.
+class TarReader {
+public:
+    explicit TarReader(const std::string& archive_path);
+    ~TarReader();
+
+    TarReader(const TarReader&) = delete;
+    TarReader& operator=(const TarReader&) = delete;
+
+    // Reads the next regular file into `name` and `content`, reusing their storage.
+    // Returns false at the end of the archive.
+    bool next(std::string& name, std::string& content);
+
+    // Byte offset of the last returned entry's content within the uncompressed archive.
+    uint64_t entry_offset() const { return last_entry_offset; }
+
+private:
+    class Stream;
+    std::unique_ptr<Stream> stream;
+    std::string archive_path;
+    uint64_t position = 0;
+    uint64_t last_entry_offset = 0;
+
+    void read_exactly(char* data, size_t size);
+    void skip(uint64_t size);
+};
+
+}  // namespace go_data_gen
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
 #include <utility>
 
 namespace go_data_gen {
@@ -52,6 +53,22 @@ struct Move {
     bool operator!=(const Move& other) const { return !(operator==(other)); }
 };
 
+// 4-byte move for arrays of moves, e.g. numpy arrays shared with Python.
+struct PackedMove {
+    int8_t color;
+    int8_t is_pass;
+    int8_t x;  // 0 if is_pass.
+    int8_t y;  // 0 if is_pass.
+
+    static PackedMove from_move(const Move& move) {
+        return {static_cast<int8_t>(move.color), static_cast<int8_t>(move.is_pass),
+                static_cast<int8_t>(move.is_pass ? 0 : move.coord.x),
+                static_cast<int8_t>(move.is_pass ? 0 : move.coord.y)};
+    }
+    Move to_move() const { return Move{static_cast<Color>(color), is_pass != 0, Vec2{x, y}}; }
+};
+static_assert(sizeof(PackedMove) == 4);
+
 enum class MoveLegality {
     Legal = 0,
     NonEmpty = 1,
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace go_data_gen {
+
+// SplitMix64 step. Usable in constant expressions so that Zobrist tables can be generated at
+// compile time and are identical across processes and machines.
+constexpr uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+template <size_t N>
+constexpr std::array<uint64_t, N> make_zobrist_table(uint64_t seed) {
+    std::array<uint64_t, N> table{};
+    for (size_t i = 0; i < N; ++i) {
+        table[i] = splitmix64(seed);
+    }
+    return table;
+}
+
+static constexpr uint64_t default_zobrist_seed = 0x676f5f646174615fULL;  // "go_data_"
+
+// Regenerates the Zobrist tables from `seed`.
+// Not thread-safe: must be called before any Board is constructed or used, since hashes computed
+// with different seeds are not comparable.
+void set_zobrist_seed(uint64_t seed);
+uint64_t get_zobrist_seed();
+
+}  // namespace go_data_gen
@@ -4,14 +4,170 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <cstring>
+#include <fstream>
+#include <optional>
+
 #include "go_data_gen/board.hpp"
+#include "go_data_gen/board_batch.hpp"
+#include "go_data_gen/bucketed_batcher.hpp"
+#include "go_data_gen/corpus_job.hpp"
+#include "go_data_gen/feature_cache.hpp"
+#include "go_data_gen/feature_expand.hpp"
+#include "go_data_gen/feature_set.hpp"
+#include "go_data_gen/feature_server.hpp"
+#include "go_data_gen/file_reader.hpp"
+#include "go_data_gen/game_file.hpp"
+#include "go_data_gen/incremental_featurizer.hpp"
+#include "go_data_gen/position_index.hpp"
 #include "go_data_gen/sgf.hpp"
+#include "go_data_gen/sgf_index.hpp"
+#include "go_data_gen/shared_position_ring.hpp"
+#include "go_data_gen/tar_reader.hpp"
 #include "go_data_gen/types.hpp"
+#include "go_data_gen/zobrist.hpp"
 
 namespace py = pybind11;
 
 using namespace go_data_gen;
 
+namespace {
+
+py::array_t<float> feature_planes_to_array(const Board::StackedFeaturePlanes& feature_planes) {
+    auto features_array =
+        py::array_t<float>({Board::data_size, Board::data_size, Board::num_feature_planes});
+    // Same (y, x, plane) layout, so the planes can be copied in one go.
+    std::memcpy(features_array.mutable_data(), &feature_planes[0][0][0], sizeof(feature_planes));
+    return features_array;
+}
+
+py::array_t<float> feature_scalars_to_array(const Board::FeatureVector& scalar_features) {
+    auto scalars_array = py::array_t<float>({Board::num_feature_scalars});
+    auto scalars_mu = scalars_array.mutable_unchecked<1>();
+    std::memcpy(scalars_mu.mutable_data(0), scalar_features.data(),
+                Board::num_feature_scalars * sizeof(float));
+    return scalars_array;
+}
+
+// Returns ([H, W, num_planes] feature planes, [num_scalars] feature scalars) of `Features`.
+template <typename Features>
+py::tuple compute_feature_set(Board& board, Color to_play) {
+    typename Features::PlaneRows rows;
+    typename Features::Scalars scalars;
+    Features::compute(board, to_play, rows, scalars);
+    auto planes = py::array_t<float>({Board::data_size, Board::data_size, Features::num_planes});
+    expand_rows_hwc(&rows[0][0], Board::data_size, Board::data_size, Features::num_planes,
+                    planes.mutable_data());
+    auto scalars_array = py::array_t<float>({Features::num_scalars});
+    std::memcpy(scalars_array.mutable_data(), scalars.data(), sizeof(scalars));
+    return py::make_tuple(planes, scalars_array);
+}
+
+using MoveArray = py::array_t<int, py::array::c_style | py::array::forcecast>;
+
+void check_batch_moves(const BoardBatch& batch, const MoveArray& moves) {
+    if (moves.ndim() != 1 || moves.shape(0) != batch.size()) {
+        throw std::invalid_argument("Expected one move per board");
+    }
+}
+
+// Returns (feature_planes, feature_scalars, legal_masks) for all boards of the batch.
+// If `moves` is given, plays them first.
+py::tuple batch_step(BoardBatch& batch, const MoveArray* moves) {
+    const py::ssize_t n = batch.size();
+    auto planes = py::array_t<float>(
+        {n, py::ssize_t{Board::num_feature_planes}, py::ssize_t{Board::data_size},
+         py::ssize_t{Board::data_size}});
+    auto scalars = py::array_t<float>({n, py::ssize_t{Board::num_feature_scalars}});
+    auto legal_masks =
+        py::array_t<uint8_t>({n, py::ssize_t{Board::data_size}, py::ssize_t{Board::data_size}});
+    float* planes_data = planes.mutable_data();
+    float* scalars_data = scalars.mutable_data();
+    uint8_t* legal_masks_data = legal_masks.mutable_data();
+    {
+        py::gil_scoped_release release;
+        if (moves != nullptr) {
+            batch.step(moves->data(), planes_data, scalars_data, legal_masks_data);
+        } else {
+            batch.get_features(planes_data, scalars_data, legal_masks_data);
+        }
+    }
+    return py::make_tuple(planes, scalars, legal_masks);
+}
+
+py::tuple sgf_to_tuple(bool is_valid, const Board& board, const std::vector<Move>& moves,
+                       float result) {
+    if (!is_valid) {
+        // Return (False, None, None, None) for invalid games
+        return py::make_tuple(false, py::none(), py::none(), py::none());
+    }
+    // Return (True, board, moves, result) for valid games
+    return py::make_tuple(true, board, moves, result);
+}
+
+using PackedMoveArray = py::array_t<PackedMove, py::array::c_style | py::array::forcecast>;
+using Int8Array = py::array_t<int8_t, py::array::c_style | py::array::forcecast>;
+
+PackedMoveArray moves_to_array(const std::vector<Move>& moves) {
+    auto moves_array = PackedMoveArray(static_cast<py::ssize_t>(moves.size()));
+    PackedMove* data = moves_array.mutable_data();
+    for (size_t i = 0; i < moves.size(); ++i) {
+        data[i] = PackedMove::from_move(moves[i]);
+    }
+    return moves_array;
+}
+
+// Returns None for games in the encore phase, like load_sgf returns is_valid == False.
+py::object sgf_to_dict(bool is_valid, const Board& board, const std::vector<Move>& moves,
+                       float result) {
+    if (!is_valid) {
+        return py::none();
+    }
+    auto moves_array = moves_to_array(moves);
+    py::dict game;
+    game["board"] = board;
+    game["moves"] = moves_array;
+    // Field views of the same memory.
+    for (const char* field : {"color", "is_pass", "x", "y"}) {
+        game[field] = moves_array[field];
+    }
+    game["komi"] = board.komi;
+    game["num_handicap_stones"] = board.num_handicap_stones;
+    game["ruleset"] = board.ruleset;
+    game["result"] = result;
+    return std::move(game);
+}
+
+// Plays moves[start:stop] without crossing into Python per move.
+void play_packed_moves(Board& board, const PackedMove* moves, py::ssize_t num_moves,
+                       py::ssize_t start, std::optional<py::ssize_t> stop) {
+    const py::ssize_t end = stop.value_or(num_moves);
+    if (start < 0 || start > end || end > num_moves) {
+        throw std::out_of_range("Invalid move range");
+    }
+    py::gil_scoped_release release;
+    board.play_moves(moves + start, end - start);
+}
+
+// View of one field across all slots of the ring, with shape [num_slots, *shape].
+template <typename T>
+py::array ring_field_view(py::object ring_object, const T* first,
+                          std::vector<py::ssize_t> shape) {
+    auto& ring = ring_object.cast<SharedPositionRing&>();
+    std::vector<py::ssize_t> strides(shape.size());
+    py::ssize_t stride = sizeof(T);
+    for (size_t i = shape.size(); i-- > 0;) {
+        strides[i] = stride;
+        stride *= shape[i];
+    }
+    shape.insert(shape.begin(), ring.num_slots());
+    strides.insert(strides.begin(), sizeof(SharedPositionRing::Slot));
+    // The ring object keeps the mapping alive for as long as the view exists.
+    return py::array_t<T>(shape, strides, first, ring_object);
+}
+
+}  // namespace
+
 PYBIND11_MODULE(go_data_gen, m) {
     m.doc() = "Python bindings for go_data_gen C++ library";
 
@@ -39,12 +195,43 @@ PYBIND11_MODULE(go_data_gen, m) {
 
     m.def("opposite", &opposite, "Get the opposite color", py::arg("color"));
 
+    PYBIND11_NUMPY_DTYPE(PackedMove, color, is_pass, x, y);
+
     py::class_<Move>(m, "Move")
         .def(py::init<Color, bool, Vec2>())
         .def_readwrite("color", &Move::color)
         .def_readwrite("is_pass", &Move::is_pass)
         .def_readwrite("coord", &Move::coord);
 
+    py::enum_<KoRule>(m, "KoRule")
+        .value("Simple", KoRule::Simple)
+        .value("PositionalSuperko", KoRule::PositionalSuperko)
+        .value("SituationalSuperko", KoRule::SituationalSuperko);
+
+    py::enum_<SuicideRule>(m, "SuicideRule")
+        .value("Allowed", SuicideRule::Allowed)
+        .value("Disallowed", SuicideRule::Disallowed);
+
+    py::enum_<ScoringRule>(m, "ScoringRule")
+        .value("Area", ScoringRule::Area)
+        .value("Territory", ScoringRule::Territory);
+
+    py::enum_<TaxRule>(m, "TaxRule")
+        .value("NoTax", TaxRule::NoTax)
+        .value("Seki", TaxRule::Seki)
+        .value("All", TaxRule::All);
+
+    py::enum_<FirstPlayerPassBonusRule>(m, "FirstPlayerPassBonusRule")
+        .value("NoBonus", FirstPlayerPassBonusRule::NoBonus)
+        .value("Bonus", FirstPlayerPassBonusRule::Bonus);
+
+    py::class_<Ruleset>(m, "Ruleset")
+        .def_readwrite("ko_rule", &Ruleset::ko_rule)
+        .def_readwrite("suicide_rule", &Ruleset::suicide_rule)
+        .def_readwrite("scoring_rule", &Ruleset::scoring_rule)
+        .def_readwrite("tax_rule", &Ruleset::tax_rule)
+        .def_readwrite("first_player_pass_bonus_rule", &Ruleset::first_player_pass_bonus_rule);
+
     py::enum_<MoveLegality>(m, "MoveLegality")
         .value("Legal", MoveLegality::Legal)
         .value("NonEmpty", MoveLegality::NonEmpty)
@@ -59,43 +246,314 @@ PYBIND11_MODULE(go_data_gen, m) {
         .def(py::init<Vec2, float>())
         .def("get_board_size", &Board::get_board_size)
         .def_readwrite("komi", &Board::komi)
+        .def_readwrite("num_handicap_stones", &Board::num_handicap_stones)
+        .def_readwrite("ruleset", &Board::ruleset)
         .def("reset", &Board::reset)
         .def("setup_move", &Board::setup_move)
         .def("get_move_legality", &Board::get_move_legality)
         .def("is_legal", &Board::is_legal)
         .def("play", &Board::play)
+        .def(
+            "play_moves",
+            [](Board& self, const PackedMoveArray& moves, py::ssize_t start,
+               std::optional<py::ssize_t> stop) {
+                if (moves.ndim() != 1) {
+                    throw std::invalid_argument("Expected a 1-d array of moves");
+                }
+                play_packed_moves(self, moves.data(), moves.shape(0), start, stop);
+            },
+            "Play moves[start:stop] of a structured move array, as returned by load_sgf_moves. "
+            "Raises on the first illegal move; the moves before it remain played.",
+            py::arg("moves"), py::arg("start") = 0, py::arg("stop") = py::none())
+        .def(
+            "play_moves",
+            [](Board& self, const Int8Array& color, const Int8Array& is_pass, const Int8Array& x,
+               const Int8Array& y, py::ssize_t start, std::optional<py::ssize_t> stop) {
+                const py::ssize_t n = color.size();
+                if (color.ndim() != 1 || is_pass.size() != n || x.size() != n || y.size() != n) {
+                    throw std::invalid_argument("Expected 1-d move arrays of equal length");
+                }
+                std::vector<PackedMove> moves(n);
+                for (py::ssize_t i = 0; i < n; ++i) {
+                    moves[i] = {color.data()[i], is_pass.data()[i], x.data()[i], y.data()[i]};
+                }
+                play_packed_moves(self, moves.data(), n, start, stop);
+            },
+            "Same as above, with the moves given as separate int8 arrays.", py::arg("color"),
+            py::arg("is_pass"), py::arg("x"), py::arg("y"), py::arg("start") = 0,
+            py::arg("stop") = py::none())
         .def_readonly_static("num_feature_planes", &Board::num_feature_planes)
         .def_readonly_static("legal_move_plane_index", &Board::legal_move_plane_index)
         .def_readonly_static("on_board_plane_index", &Board::on_board_plane_index)
+        .def_readonly_static("lookahead_plane_index", &Board::lookahead_plane_index)
+        .def_readonly_static("num_lookahead_planes", &Board::num_lookahead_planes)
         .def("get_feature_planes",
              [](Board& self, Color to_play) {
-                 auto feature_planes = self.get_feature_planes(to_play);
-                 auto features_array = py::array_t<float>(
-                     {Board::data_size, Board::data_size, Board::num_feature_planes});
-                 auto features_mu = features_array.mutable_unchecked<3>();
-                 for (size_t y = 0; y < Board::data_size; ++y) {
-                     for (size_t x = 0; x < Board::data_size; ++x) {
-                         for (size_t c = 0; c < Board::num_feature_planes; ++c) {
-                             features_mu(y, x, c) = feature_planes[y][x][c];
-                         }
-                     }
-                 }
-                 return features_array;
+                 return feature_planes_to_array(self.get_feature_planes(to_play));
              })
+        .def_readonly_static("max_stone_history", &Board::max_stone_history)
+        .def(
+            "get_stone_history_planes",
+            [](const Board& self, Color to_play, int num_positions) {
+                std::vector<uint32_t> rows(Board::data_size * 2 * num_positions);
+                self.get_stone_history_rows(to_play, num_positions, rows.data());
+                auto planes = py::array_t<float>({py::ssize_t{Board::data_size},
+                                                  py::ssize_t{Board::data_size},
+                                                  static_cast<py::ssize_t>(2 * num_positions)});
+                expand_rows_hwc(rows.data(), Board::data_size, Board::data_size,
+                                2 * num_positions, planes.mutable_data());
+                return planes;
+            },
+            "Return [H, W, 2 * num_positions] planes of own and opponent stones of the current "
+            "and previous positions, most recent first.",
+            py::arg("to_play"), py::arg("num_positions"))
         .def_readonly_static("num_feature_scalars", &Board::num_feature_scalars)
         .def("get_feature_scalars",
              [](Board& self, Color to_play) {
-                 auto scalar_features = self.get_feature_scalars(to_play);
-                 auto scalars_array = py::array_t<float>({Board::num_feature_scalars});
-                 auto scalars_mu = scalars_array.mutable_unchecked<1>();
-                 std::memcpy(scalars_mu.mutable_data(0), scalar_features.data(),
-                             Board::num_feature_scalars * sizeof(float));
-                 return scalars_array;
+                 return feature_scalars_to_array(self.get_feature_scalars(to_play));
              })
+        .def("get_features", &compute_feature_set<DefaultFeatures>,
+             "Return (feature_planes, feature_scalars). Faster than calling get_feature_planes "
+             "and get_feature_scalars separately, since both need the legality of all points.",
+             py::arg("to_play"))
+        .def_readonly_static("num_stone_feature_planes", &StoneFeatures::num_planes)
+        .def_readonly_static("num_stone_feature_scalars", &StoneFeatures::num_scalars)
+        .def("get_stone_features", &compute_feature_set<StoneFeatures>,
+             "Return (feature_planes, feature_scalars) of only the stone, liberty, move history "
+             "and komi features. Much faster than get_features, since it skips the legality of "
+             "all points.",
+             py::arg("to_play"))
+        .def("get_feature_key", &Board::get_feature_key, py::arg("to_play"))
+        .def_readonly_static("num_symmetries", &Board::num_symmetries)
+        .def("get_symmetric_hashes", &Board::get_symmetric_hashes)
+        .def("get_canonical_hash", &Board::get_canonical_hash, py::arg("to_play"))
         .def("print", &Board::print,
              py::arg("highlight_fn") = py::cpp_function([](int, int) { return false; }))
         .def("print_group_sizes", &Board::print_group_sizes)
-        .def("print_liberties", &Board::print_liberties);
+        .def("print_liberties", &Board::print_liberties)
+        .def(
+            "get_group_data",
+            [](Board& self) {
+                const Vec2 size = self.get_board_size();
+                auto group_ids = py::array_t<int8_t>({size.y, size.x});
+                auto group_sizes = py::array_t<int8_t>({size.y, size.x});
+                auto liberty_counts = py::array_t<int8_t>({size.y, size.x});
+                self.get_group_data(group_ids.mutable_data(), group_sizes.mutable_data(),
+                                    liberty_counts.mutable_data());
+                return py::make_tuple(group_ids, group_sizes, liberty_counts);
+            },
+            "Return (group_ids, group_sizes, liberties) of the current position as int8 [H, W] "
+            "arrays. Empty points have id -1, size 0 and 0 liberties, and values above 127 are "
+            "stored as 127.")
+        .def(
+            "get_game_group_data",
+            [](const Board& self, const PackedMoveArray& moves) {
+                if (moves.ndim() != 1) {
+                    throw std::invalid_argument("Expected a 1-d array of moves");
+                }
+                const Vec2 size = self.get_board_size();
+                const py::ssize_t n = moves.shape(0) + 1;
+                auto group_ids = py::array_t<int8_t>({n, py::ssize_t{size.y}, py::ssize_t{size.x}});
+                auto group_sizes =
+                    py::array_t<int8_t>({n, py::ssize_t{size.y}, py::ssize_t{size.x}});
+                auto liberty_counts =
+                    py::array_t<int8_t>({n, py::ssize_t{size.y}, py::ssize_t{size.x}});
+                int8_t* group_ids_data = group_ids.mutable_data();
+                int8_t* group_sizes_data = group_sizes.mutable_data();
+                int8_t* liberty_counts_data = liberty_counts.mutable_data();
+                {
+                    py::gil_scoped_release release;
+                    Board board = self;
+                    board.get_game_group_data(moves.data(), moves.shape(0), group_ids_data,
+                                              group_sizes_data, liberty_counts_data);
+                }
+                return py::make_tuple(group_ids, group_sizes, liberty_counts);
+            },
+            "Replay a structured move array, as returned by load_sgf_moves, on a copy of the "
+            "board and return (group_ids, group_sizes, liberties) as int8 [N + 1, H, W] arrays: "
+            "the current position, then the position after each move. See get_group_data. Raises "
+            "on the first illegal move.",
+            py::arg("moves"))
+        .def(
+            "serialize", [](const Board& self) { return py::bytes(self.serialize()); },
+            "Return the full board in a compact binary form. See Board.deserialize.")
+        .def_static(
+            "deserialize",
+            [](const py::bytes& data) {
+                Board board;
+                board.deserialize(static_cast<std::string_view>(data));
+                return board;
+            },
+            "Restore a board from Board.serialize. The zobrist seed must be the same.",
+            py::arg("data"))
+        .def(py::pickle([](const Board& self) { return py::bytes(self.serialize()); },
+                        [](const py::bytes& data) {
+                            Board board;
+                            board.deserialize(static_cast<std::string_view>(data));
+                            return board;
+                        }));
+
+    py::class_<PositionIndex>(m, "PositionIndex")
+        .def(py::init<size_t, const std::string&>(), py::arg("max_entries") = size_t{1} << 24,
+             py::arg("spill_dir") = "")
+        .def("insert", &PositionIndex::insert,
+             "Record one occurrence of a position hash and return the number of previous "
+             "occurrences. 0 means the position is new.",
+             py::arg("hash"), py::call_guard<py::gil_scoped_release>())
+        .def("count", &PositionIndex::count, py::arg("hash"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("__len__", &PositionIndex::size)
+        .def("num_spilled", &PositionIndex::num_spilled)
+        .def("clear", &PositionIndex::clear);
+
+    py::class_<BoardBatch>(m, "BoardBatch")
+        .def_readonly_static("pass_move", &BoardBatch::pass_move)
+        .def_readonly_static("no_move", &BoardBatch::no_move)
+        .def(py::init([](int num_boards, Vec2 board_size, float komi, int num_threads) {
+                 return std::make_unique<BoardBatch>(num_boards, board_size, komi,
+                                                     TrompTaylorRules, num_threads);
+             }),
+             py::arg("num_boards"), py::arg("board_size") = Vec2{19, 19}, py::arg("komi") = 7.5f,
+             py::arg("num_threads") = 0)
+        .def("__len__", &BoardBatch::size)
+        .def("board", &BoardBatch::board, py::return_value_policy::reference_internal,
+             py::arg("index"))
+        .def("to_play", &BoardBatch::get_to_play)
+        .def("reset", py::overload_cast<>(&BoardBatch::reset))
+        .def("reset_board", py::overload_cast<int>(&BoardBatch::reset), py::arg("index"))
+        .def(
+            "play",
+            [](BoardBatch& self, const MoveArray& moves) {
+                check_batch_moves(self, moves);
+                py::gil_scoped_release release;
+                self.play(moves.data());
+            },
+            "Play one move per board, encoded as y * max_board_size + x, pass_move or no_move. "
+            "If any move is off the board or illegal, this raises and no board changes.",
+            py::arg("moves"))
+        .def(
+            "get_features", [](BoardBatch& self) { return batch_step(self, nullptr); },
+            "Return (feature_planes [N, C, H, W], feature_scalars [N, S], legal_masks [N, H, W]).")
+        .def(
+            "step",
+            [](BoardBatch& self, const MoveArray& moves) {
+                check_batch_moves(self, moves);
+                return batch_step(self, &moves);
+            },
+            "Play one move per board and return the features of the resulting positions, "
+            "like get_features. Raises without changing any board like play.",
+            py::arg("moves"));
+
+    py::class_<BucketedBatcher>(m, "BucketedBatcher",
+                                "Groups positions by board size into batches cropped to the "
+                                "board plus padding.")
+        .def(py::init<int>(), py::arg("batch_size"))
+        .def("add",
+             py::overload_cast<Board&, Color, const Move&, float>(&BucketedBatcher::add),
+             py::arg("board"), py::arg("to_play"), py::arg("move"), py::arg("result"))
+        .def("flush", &BucketedBatcher::flush,
+             "Make all partially filled batches ready, e.g. at the end of an epoch.")
+        .def("__len__", &BucketedBatcher::num_ready)
+        .def(
+            "pop",
+            [](BucketedBatcher& self) -> py::object {
+                BucketedBatcher::Batch batch;
+                if (!self.pop(batch)) {
+                    return py::none();
+                }
+                const py::ssize_t n = batch.size;
+                const py::ssize_t height = batch.height;
+                const py::ssize_t width = batch.width;
+                auto planes = py::array_t<float>(
+                    {n, py::ssize_t{Board::num_feature_planes}, height, width});
+                auto scalars = py::array_t<float>({n, py::ssize_t{Board::num_feature_scalars}});
+                auto masks = py::array_t<uint8_t>({n, height, width});
+                auto moves = py::array_t<int>(n);
+                auto results = py::array_t<float>(n);
+                std::memcpy(planes.mutable_data(), batch.feature_planes.data(),
+                            batch.feature_planes.size() * sizeof(float));
+                std::memcpy(scalars.mutable_data(), batch.feature_scalars.data(),
+                            batch.feature_scalars.size() * sizeof(float));
+                std::memcpy(masks.mutable_data(), batch.masks.data(), batch.masks.size());
+                std::memcpy(moves.mutable_data(), batch.moves.data(), n * sizeof(int));
+                std::memcpy(results.mutable_data(), batch.results.data(), n * sizeof(float));
+                return py::make_tuple(batch.board_size, planes, scalars, masks, moves, results);
+            },
+            "Return the oldest ready batch as (board_size, feature_planes [N, C, H, W], "
+            "feature_scalars [N, S], masks [N, H, W], moves [N], results [N]), or None. Moves "
+            "index the flattened H x W grid, or are -1 for a pass.");
+
+    py::class_<FeatureCache>(m, "FeatureCache")
+        .def(py::init<size_t>(), py::arg("capacity"))
+        .def(
+            "get_features",
+            [](FeatureCache& self, Board& board, Color to_play) {
+                Board::StackedFeaturePlanes feature_planes;
+                Board::FeatureVector scalar_features;
+                {
+                    py::gil_scoped_release release;
+                    self.get_features(board, to_play, feature_planes, scalar_features);
+                }
+                return py::make_tuple(feature_planes_to_array(feature_planes),
+                                      feature_scalars_to_array(scalar_features));
+            },
+            "Return (feature_planes, feature_scalars) of the board, computing them only if the "
+            "position is not cached.",
+            py::arg("board"), py::arg("to_play"))
+        .def_property_readonly("hits", &FeatureCache::hits)
+        .def_property_readonly("misses", &FeatureCache::misses)
+        .def_property_readonly("hit_rate", &FeatureCache::hit_rate)
+        .def("__len__", &FeatureCache::size)
+        .def("clear", &FeatureCache::clear);
+
+    py::class_<IncrementalFeaturizer>(m, "IncrementalFeaturizer")
+        .def(py::init<Board&, Color>(), py::arg("board"), py::arg("to_play") = Black,
+             py::keep_alive<1, 2>())
+        .def("refresh", &IncrementalFeaturizer::refresh,
+             "Recompute all features after the board was changed without going through play.")
+        .def("play", &IncrementalFeaturizer::play,
+             "Play a move on the board and update the features for the opponent.", py::arg("move"))
+        .def("get_to_play", &IncrementalFeaturizer::get_to_play)
+        .def("get_feature_planes",
+             [](const IncrementalFeaturizer& self) {
+                 return feature_planes_to_array(self.get_feature_planes());
+             })
+        .def("get_feature_scalars",
+             [](IncrementalFeaturizer& self) {
+                 return feature_scalars_to_array(self.get_feature_scalars());
+             })
+        .def(
+            "get_last_changes",
+            [](const IncrementalFeaturizer& self) {
+                const auto& changes = self.get_last_changes();
+                static_assert(sizeof(IncrementalFeaturizer::Change) == 4);
+                auto changes_array = py::array_t<uint8_t>(
+                    {static_cast<py::ssize_t>(changes.size()), py::ssize_t{4}});
+                if (!changes.empty()) {
+                    std::memcpy(changes_array.mutable_data(), changes.data(),
+                                changes.size() * sizeof(IncrementalFeaturizer::Change));
+                }
+                return changes_array;
+            },
+            "Return the feature plane entries changed by the last play as rows of "
+            "(y, x, plane, value).");
+
+    py::enum_<SimdLevel>(m, "SimdLevel")
+        .value("Scalar", SimdLevel::Scalar)
+        .value("SSE2", SimdLevel::SSE2)
+        .value("AVX2", SimdLevel::AVX2);
+    m.def("get_supported_simd_level", &get_supported_simd_level);
+    m.def("get_simd_level", &get_simd_level);
+    m.def("set_simd_level", &set_simd_level,
+          "Restrict the feature expansion kernels to a SIMD level, clamped to what the CPU "
+          "supports.",
+          py::arg("level"));
+
+    m.attr("default_zobrist_seed") = default_zobrist_seed;
+    m.def("set_zobrist_seed", &set_zobrist_seed,
+          "Regenerate the Zobrist tables from a seed. Must be called before any Board is created.",
+          py::arg("seed"));
+    m.def("get_zobrist_seed", &get_zobrist_seed, "Get the seed of the current Zobrist tables.");
 
     m.def(
         "load_sgf",
@@ -104,16 +562,410 @@ PYBIND11_MODULE(go_data_gen, m) {
             std::vector<Move> moves;
             float result;
             bool is_valid = load_sgf(file_path, board, moves, result);
-
-            if (!is_valid) {
-                // Return (False, None, None, None) for invalid games
-                return py::make_tuple(false, py::none(), py::none(), py::none());
-            } else {
-                // Return (True, board, moves, result) for valid games
-                return py::make_tuple(true, board, moves, result);
-            }
+            return sgf_to_tuple(is_valid, board, moves, result);
         },
         "Load SGF file and return (is_valid, board, moves, result). "
         "If the game is in encore phase, is_valid will be False and the other values will be None.",
         py::arg("file_path"));
+
+    m.def(
+        "load_sgf_from_buffer",
+        [](const py::bytes& content) {
+            Board board;
+            std::vector<Move> moves;
+            float result;
+            bool is_valid =
+                load_sgf_from_buffer(static_cast<std::string_view>(content), board, moves, result);
+            return sgf_to_tuple(is_valid, board, moves, result);
+        },
+        "Same as load_sgf, but parses SGF content given as bytes.", py::arg("content"));
+
+    py::enum_<SgfStatus>(m, "SgfStatus")
+        .value("Ok", SgfStatus::Ok)
+        .value("Skipped", SgfStatus::Skipped)
+        .value("ReadError", SgfStatus::ReadError)
+        .value("InvalidProperty", SgfStatus::InvalidProperty)
+        .value("IllegalMove", SgfStatus::IllegalMove,
+               "Illegal move, a point outside of the board, or two moves of the same color in a "
+               "row. load_sgf does not check the latter.");
+
+    py::class_<SgfLoadResult>(m, "SgfLoadResult")
+        .def_readonly("status", &SgfLoadResult::status)
+        .def_readonly("reason", &SgfLoadResult::reason)
+        .def_readonly("result", &SgfLoadResult::result)
+        .def_property_readonly(
+            "board", [](const SgfLoadResult& self) { return py::bytes(self.board); },
+            "Starting position as serialized by Board.serialize.")
+        .def_property_readonly(
+            "moves",
+            [](const SgfLoadResult& self) {
+                auto moves = PackedMoveArray(static_cast<py::ssize_t>(self.moves.size()));
+                std::memcpy(moves.mutable_data(), self.moves.data(),
+                            self.moves.size() * sizeof(PackedMove));
+                return moves;
+            },
+            "Moves as a structured array, like load_sgf_moves.")
+        .def("get_board", [](const SgfLoadResult& self) {
+            Board board;
+            board.deserialize(self.board);
+            return board;
+        });
+
+    m.def(
+        "load_sgf_many",
+        [](const std::vector<std::string>& paths, int num_threads) {
+            py::gil_scoped_release release;
+            return load_sgf_many(paths, nullptr, num_threads);
+        },
+        "Load many SGF files in parallel without holding the GIL. Returns one SgfLoadResult per "
+        "path, in order. Failures are reported by status and reason instead of exceptions. Unlike "
+        "load_sgf, games with two moves of the same color in a row are rejected as IllegalMove.",
+        py::arg("paths"), py::arg("num_threads") = 0);
+
+    py::class_<GameLoader>(
+        m, "GameLoader",
+        "Loads games one after another into reused buffers, without heap allocation once warmed "
+        "up. The board and moves are those of the last game that loaded with status Ok.")
+        .def(py::init<>())
+        .def(
+            "load",
+            [](GameLoader& self, const std::string& file_path) {
+                py::gil_scoped_release release;
+                return self.load(file_path);
+            },
+            "Load a game like load_sgf_many does. Returns the SgfStatus.", py::arg("file_path"))
+        .def(
+            "load_from_buffer",
+            [](GameLoader& self, const py::bytes& content) {
+                const auto view = static_cast<std::string_view>(content);
+                py::gil_scoped_release release;
+                return self.load_from_buffer(view);
+            },
+            "Same as load, but parses SGF content given as bytes.", py::arg("content"))
+        .def_property_readonly("board", &GameLoader::get_board,
+                               py::return_value_policy::reference_internal)
+        .def_property_readonly(
+            "moves", [](const GameLoader& self) { return moves_to_array(self.get_moves()); },
+            "Moves as a structured array, like load_sgf_moves.")
+        .def_property_readonly("result", &GameLoader::get_result)
+        .def_property_readonly("reason", &GameLoader::get_reason)
+        .def_property_readonly("peak_memory_usage", &GameLoader::get_peak_memory_usage,
+                               "Bytes held by the loader and its buffers.");
+
+    m.def("is_io_uring_available", &FileReader::is_io_uring_available,
+          "Whether load_sgf_many reads files with io_uring rather than a pool of blocking "
+          "threads.");
+
+    py::class_<SgfCompactResult>(m, "SgfCompactResult")
+        .def_readonly("status", &SgfCompactResult::status)
+        .def_readonly("reason", &SgfCompactResult::reason)
+        .def_readonly("input_bytes", &SgfCompactResult::input_bytes)
+        .def_readonly("output_bytes", &SgfCompactResult::output_bytes);
+
+    m.def(
+        "compact_sgf",
+        [](const py::bytes& content) {
+            std::string output;
+            std::string reason;
+            const SgfStatus status =
+                compact_sgf(static_cast<std::string_view>(content), output, reason);
+            return py::make_tuple(status, reason, py::bytes(output));
+        },
+        "Rewrite an SGF game as minimal canonical SGF. Returns (status, reason, output).",
+        py::arg("content"));
+    m.def("compact_sgf_files", &compact_sgf_files,
+          "Compact SGF files named relative to input_root into the same paths below output_dir. "
+          "Returns one SgfCompactResult per input.",
+          py::arg("inputs"), py::arg("input_root"), py::arg("output_dir"),
+          py::arg("num_threads") = 0, py::call_guard<py::gil_scoped_release>());
+
+    m.def(
+        "load_sgf_filtered",
+        [](const std::string& file_path, const SgfFilter& filter) {
+            Board board;
+            std::vector<Move> moves;
+            float result;
+            bool is_valid = load_sgf_filtered(file_path, filter, board, moves, result);
+            return sgf_to_tuple(is_valid, board, moves, result);
+        },
+        "Same as load_sgf, but first reads only the root node and calls filter(metadata) with its "
+        "SgfMetadata. Rejected games return is_valid == False without parsing any moves.",
+        py::arg("file_path"), py::arg("filter"));
+
+    m.def(
+        "load_sgf_moves",
+        [](const std::string& file_path) {
+            Board board;
+            std::vector<Move> moves;
+            float result;
+            bool is_valid = load_sgf(file_path, board, moves, result);
+            return sgf_to_dict(is_valid, board, moves, result);
+        },
+        "Same as load_sgf, but returns a dict with the board, the moves as a structured numpy "
+        "array of int8 fields (color, is_pass, x, y), views of these fields as separate arrays, "
+        "komi, num_handicap_stones, ruleset and result. Returns None for games in the encore "
+        "phase.",
+        py::arg("file_path"));
+
+    m.def(
+        "load_sgf_moves_from_buffer",
+        [](const py::bytes& content) {
+            Board board;
+            std::vector<Move> moves;
+            float result;
+            bool is_valid =
+                load_sgf_from_buffer(static_cast<std::string_view>(content), board, moves, result);
+            return sgf_to_dict(is_valid, board, moves, result);
+        },
+        "Same as load_sgf_moves, but parses SGF content given as bytes.", py::arg("content"));
+
+    py::class_<GameRecord>(m, "GameRecord")
+        .def_readonly("board_size", &GameRecord::board_size)
+        .def_readonly("komi", &GameRecord::komi)
+        .def_readonly("num_handicap_stones", &GameRecord::num_handicap_stones)
+        .def_readonly("result", &GameRecord::result)
+        .def_readonly("moves", &GameRecord::moves)
+        .def_readonly("checkpoint_interval", &GameRecord::checkpoint_interval)
+        .def("__len__", [](const GameRecord& self) { return self.moves.size(); })
+        .def(
+            "get_board",
+            [](const GameRecord& self, int move_index) {
+                Board board;
+                self.get_position(move_index, board);
+                return board;
+            },
+            "Return the board before moves[move_index], restored from the nearest checkpoint.",
+            py::arg("move_index"));
+
+    py::class_<GameWriter>(m, "GameWriter")
+        .def(py::init<const std::string&, int>(), py::arg("path"),
+             py::arg("checkpoint_interval") = 16)
+        .def("add_game", &GameWriter::add_game, py::arg("board"), py::arg("moves"),
+             py::arg("result"))
+        .def("close", &GameWriter::close);
+
+    py::class_<GameReader>(m, "GameReader")
+        .def(py::init<const std::string&>(), py::arg("path"))
+        .def("__len__", &GameReader::num_games)
+        .def("read_game", &GameReader::read_game, py::arg("index"));
+
+    m.def("stable_hash", [](const std::string& data) { return stable_hash(data); },
+          py::arg("data"));
+    m.def(
+        "get_shard_index",
+        [](const std::string& input, int num_shards) { return get_shard_index(input, num_shards); },
+        "Shard of an input name, stable across processes and machines.", py::arg("input"),
+        py::arg("num_shards"));
+
+    py::class_<CorpusJob>(m, "CorpusJob",
+                          "Converts SGF files into sharded position records. Interrupted jobs "
+                          "resume from their last checkpoint with byte-identical output.")
+        .def(py::init<const std::vector<std::string>&, const std::string&, const std::string&,
+                      int, int>(),
+             py::arg("inputs"), py::arg("input_root"), py::arg("output_dir"),
+             py::arg("num_shards"), py::arg("checkpoint_interval") = 64)
+        .def("num_shards", &CorpusJob::num_shards)
+        .def("get_shard_inputs", &CorpusJob::get_shard_inputs, py::arg("shard"))
+        .def("get_shard_path", &CorpusJob::get_shard_path, py::arg("shard"))
+        .def("is_shard_complete", &CorpusJob::is_shard_complete, py::arg("shard"))
+        .def(
+            "run",
+            [](CorpusJob& self, const std::vector<int>& shards, int num_threads) {
+                self.run(shards, featurize_sgf, num_threads);
+            },
+            "Featurize the given shards, skipping completed work.", py::arg("shards"),
+            py::arg("num_threads") = 0, py::call_guard<py::gil_scoped_release>());
+
+    m.def(
+        "read_position_records",
+        [](const std::string& path) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file.is_open()) {
+                throw std::runtime_error("Could not open the file: " + path);
+            }
+            std::vector<PositionRecord> records;
+            file.seekg(0, std::ios::end);
+            const size_t size = static_cast<size_t>(file.tellg());
+            if (size % sizeof(PositionRecord) != 0) {
+                throw std::runtime_error("Not a file of position records: " + path);
+            }
+            records.resize(size / sizeof(PositionRecord));
+            file.seekg(0, std::ios::beg);
+            file.read(reinterpret_cast<char*>(records.data()), size);
+
+            const py::ssize_t n = records.size();
+            auto planes = py::array_t<float>({n, py::ssize_t{Board::data_size},
+                                              py::ssize_t{Board::data_size},
+                                              py::ssize_t{Board::num_feature_planes}});
+            auto scalars = py::array_t<float>({n, py::ssize_t{Board::num_feature_scalars}});
+            auto moves = py::array_t<int16_t>(n);
+            auto to_play = py::array_t<int8_t>(n);
+            auto results = py::array_t<float>(n);
+            Board::StackedFeaturePlanes unpacked;
+            for (py::ssize_t i = 0; i < n; ++i) {
+                Board::unpack_feature_planes(records[i].planes, unpacked);
+                std::memcpy(planes.mutable_data(i), &unpacked[0][0][0], sizeof(unpacked));
+                std::memcpy(scalars.mutable_data(i), records[i].scalars.data(),
+                            sizeof(records[i].scalars));
+                moves.mutable_at(i) = records[i].move;
+                to_play.mutable_at(i) = records[i].to_play;
+                results.mutable_at(i) = records[i].result;
+            }
+            return py::make_tuple(planes, scalars, moves, to_play, results);
+        },
+        "Read a shard written by CorpusJob as (feature_planes, feature_scalars, moves, to_play, "
+        "results). Moves are y * max_board_size + x, or -1 for a pass.",
+        py::arg("path"));
+
+    py::class_<SharedPositionRing>(
+        m, "SharedPositionRing",
+        "Single-producer, multi-consumer ring of featurized positions in POSIX shared memory. "
+        "Consumers read slots in place through the numpy views feature_planes [N, C, H, W] "
+        "(uint8), feature_scalars [N, S], moves, to_play and results.")
+        .def(py::init<const std::string&, int>(),
+             "Create the ring. The name is removed again when the producer's ring is destroyed.",
+             py::arg("name"), py::arg("num_slots"))
+        .def(py::init<const std::string&>(), "Open an existing ring.", py::arg("name"))
+        .def_property_readonly("num_slots", &SharedPositionRing::num_slots)
+        .def("__len__", &SharedPositionRing::num_pending)
+        .def("push",
+             py::overload_cast<Board&, Color, const Move&, float, double>(
+                 &SharedPositionRing::push),
+             "Featurize a position into the next free slot. Returns False on timeout.",
+             py::arg("board"), py::arg("to_play"), py::arg("move"), py::arg("result"),
+             py::arg("timeout") = -1.0, py::call_guard<py::gil_scoped_release>())
+        .def("close", &SharedPositionRing::close)
+        .def(
+            "acquire",
+            [](SharedPositionRing& self, double timeout) -> py::object {
+                int index;
+                {
+                    py::gil_scoped_release release;
+                    index = self.acquire(timeout);
+                }
+                return index < 0 ? py::none() : py::int_(index);
+            },
+            "Take the next published position and return its slot index, or None on timeout or "
+            "once the ring is closed and drained. Pass the index to release when done.",
+            py::arg("timeout") = -1.0)
+        .def("release", &SharedPositionRing::release, py::arg("index"))
+        .def_property_readonly("feature_planes",
+                               [](py::object self) {
+                                   auto& ring = self.cast<SharedPositionRing&>();
+                                   return ring_field_view(
+                                       self, &ring.slot(0).feature_planes[0][0][0],
+                                       {Board::num_feature_planes, Board::data_size,
+                                        Board::data_size});
+                               })
+        .def_property_readonly("feature_scalars",
+                               [](py::object self) {
+                                   auto& ring = self.cast<SharedPositionRing&>();
+                                   return ring_field_view(self, &ring.slot(0).feature_scalars[0],
+                                                          {Board::num_feature_scalars});
+                               })
+        .def_property_readonly("moves",
+                               [](py::object self) {
+                                   auto& ring = self.cast<SharedPositionRing&>();
+                                   return ring_field_view(self, &ring.slot(0).move, {});
+                               })
+        .def_property_readonly("to_play",
+                               [](py::object self) {
+                                   auto& ring = self.cast<SharedPositionRing&>();
+                                   return ring_field_view(self, &ring.slot(0).to_play, {});
+                               })
+        .def_property_readonly("results", [](py::object self) {
+            auto& ring = self.cast<SharedPositionRing&>();
+            return ring_field_view(self, &ring.slot(0).result, {});
+        });
+
+    py::class_<FeatureClient>(m, "FeatureClient",
+                              "Client of the feature_server executable, which keeps one board per "
+                              "game so that only new moves need to be sent.")
+        .def(py::init<const std::string&>(), "Connect to a server listening on a Unix socket.",
+             py::arg("socket_path"))
+        .def(py::init<int, int>(), "Talk to a server over file descriptors, e.g. pipes.",
+             py::arg("in_fd"), py::arg("out_fd"))
+        .def("new_game", &FeatureClient::new_game,
+             "Start a game from the given board and return its session id.", py::arg("board"),
+             py::call_guard<py::gil_scoped_release>())
+        .def(
+            "play",
+            [](FeatureClient& self, uint32_t session_id, const PackedMoveArray& moves) {
+                if (moves.ndim() != 1) {
+                    throw std::invalid_argument("Expected a 1-D array of moves");
+                }
+                py::gil_scoped_release release;
+                self.play(session_id, moves.data(), moves.shape(0));
+            },
+            "Play moves, given as a structured array like load_sgf_moves returns.",
+            py::arg("session_id"), py::arg("moves"))
+        .def(
+            "get_features",
+            [](FeatureClient& self, uint32_t session_id, Color to_play) {
+                Board::FeaturePlaneRows rows;
+                Board::FeatureVector scalars;
+                {
+                    py::gil_scoped_release release;
+                    self.get_features(session_id, to_play, rows, scalars);
+                }
+                auto planes = py::array_t<float>(
+                    {Board::data_size, Board::data_size, Board::num_feature_planes});
+                expand_rows_hwc(&rows[0][0], Board::data_size, Board::data_size,
+                                Board::num_feature_planes, planes.mutable_data());
+                return py::make_tuple(planes, feature_scalars_to_array(scalars));
+            },
+            "Return (feature_planes, feature_scalars) of the current position, with the same "
+            "layout as Board.get_feature_planes.",
+            py::arg("session_id"), py::arg("to_play"))
+        .def("close_game", &FeatureClient::close_game, py::arg("session_id"),
+             py::call_guard<py::gil_scoped_release>());
+
+    py::class_<TarReader>(m, "TarReader",
+                          "Iterates over (name, content) of the regular files in a tar archive, "
+                          "optionally gzip-compressed, without unpacking it.")
+        .def(py::init<const std::string&>(), py::arg("archive_path"))
+        .def("__iter__", [](TarReader& self) -> TarReader& { return self; })
+        .def("__next__",
+             [](TarReader& self) {
+                 std::string name;
+                 std::string content;
+                 bool has_next;
+                 {
+                     py::gil_scoped_release release;
+                     has_next = self.next(name, content);
+                 }
+                 if (!has_next) {
+                     throw py::stop_iteration();
+                 }
+                 return py::make_tuple(name, py::bytes(content));
+             })
+        .def("entry_offset", &TarReader::entry_offset);
+
+    py::class_<SgfMetadata>(m, "SgfMetadata")
+        .def(py::init<>())
+        .def_readwrite("path", &SgfMetadata::path)
+        .def_readwrite("offset", &SgfMetadata::offset)
+        .def_readwrite("length", &SgfMetadata::length)
+        .def_readwrite("board_size", &SgfMetadata::board_size)
+        .def_readwrite("komi", &SgfMetadata::komi)
+        .def_readwrite("num_handicap_stones", &SgfMetadata::num_handicap_stones)
+        .def_readwrite("rules", &SgfMetadata::rules)
+        .def_readwrite("result", &SgfMetadata::result)
+        .def_readwrite("start_turn_index", &SgfMetadata::start_turn_index,
+                       "-1 if the root has no valid startTurnIdx.")
+        .def_readwrite("num_moves", &SgfMetadata::num_moves)
+        .def_readwrite("began_in_encore", &SgfMetadata::began_in_encore)
+        .def_readwrite("is_valid", &SgfMetadata::is_valid);
+
+    m.def("scan_sgf_files", &scan_sgf_files,
+          "Read the root-node metadata of SGF files in parallel, without replaying any moves.",
+          py::arg("paths"), py::arg("num_threads") = 0, py::call_guard<py::gil_scoped_release>());
+    m.def("scan_sgf_directory", &scan_sgf_directory,
+          "Recursively scan all .sgf files below a directory in parallel. Sorted by path.",
+          py::arg("directory"), py::arg("num_threads") = 0,
+          py::call_guard<py::gil_scoped_release>());
+    m.def("write_sgf_index", &write_sgf_index, "Write scanned SGF metadata to a binary index file.",
+          py::arg("index_path"), py::arg("entries"), py::call_guard<py::gil_scoped_release>());
+    m.def("read_sgf_index", &read_sgf_index, "Read SGF metadata from a binary index file.",
+          py::arg("index_path"), py::call_guard<py::gil_scoped_release>());
 }
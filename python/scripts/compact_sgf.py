@@ -0,0 +1,54 @@
+import argparse
+import collections
+import os
+
+import go_data_gen
+
+
+def list_sgf_files(directory: str):
+    """List all .sgf files below a directory, relative to it."""
+    paths = []
+    for root, _, files in os.walk(directory):
+        for name in files:
+            if name.lower().endswith('.sgf'):
+                paths.append(os.path.relpath(os.path.join(root, name), directory))
+    return sorted(paths)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Rewrite a directory of SGF files as minimal canonical SGF, keeping only what "
+        "load_sgf uses. Every move is checked for legality; files that fail are not written.")
+    parser.add_argument('input_dir')
+    parser.add_argument('output_dir')
+    parser.add_argument('--num-threads', type=int, default=0)
+    parser.add_argument('--show-failures', type=int, default=10,
+                        help="Number of failed files to list.")
+    args = parser.parse_args()
+
+    inputs = list_sgf_files(args.input_dir)
+    results = go_data_gen.compact_sgf_files(inputs, args.input_dir, args.output_dir,
+                                            args.num_threads)
+
+    input_bytes = sum(result.input_bytes for result in results)
+    output_bytes = sum(result.output_bytes for result in results)
+    written_input_bytes = sum(result.input_bytes for result in results
+                              if result.status == go_data_gen.SgfStatus.Ok)
+    failures = [(path, result) for path, result in zip(inputs, results)
+                if result.status != go_data_gen.SgfStatus.Ok]
+
+    print(f"{len(inputs) - len(failures)} of {len(inputs)} files written to {args.output_dir}")
+    if written_input_bytes > 0:
+        saved = written_input_bytes - output_bytes
+        print(f"{written_input_bytes} -> {output_bytes} bytes, saved {saved} bytes "
+              f"({100 * saved / written_input_bytes:.1f}%)")
+    print(f"{input_bytes} bytes read in total")
+    if failures:
+        counts = collections.Counter(result.status.name for _, result in failures)
+        print("Failures: " + ", ".join(f"{name}: {count}" for name, count in counts.items()))
+        for path, result in failures[:args.show_failures]:
+            print(f"  {path}: {result.reason}")
+
+
+if __name__ == "__main__":
+    main()
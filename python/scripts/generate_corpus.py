@@ -0,0 +1,47 @@
+import argparse
+import os
+
+import go_data_gen
+
+
+def list_sgf_files(directory: str):
+    """List all .sgf files below a directory, relative to it."""
+    paths = []
+    for root, _, files in os.walk(directory):
+        for name in files:
+            if name.lower().endswith('.sgf'):
+                paths.append(os.path.relpath(os.path.join(root, name), directory))
+    return sorted(paths)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Convert a directory of SGF files into sharded position records. "
+        "Rerunning the same command resumes an interrupted job.")
+    parser.add_argument('input_dir')
+    parser.add_argument('output_dir')
+    parser.add_argument('--num-shards', type=int, default=256)
+    parser.add_argument('--checkpoint-interval', type=int, default=64,
+                        help="Number of input files between progress checkpoints.")
+    parser.add_argument('--num-workers', type=int, default=1,
+                        help="Number of independent processes or nodes sharing the job.")
+    parser.add_argument('--worker-index', type=int, default=0)
+    parser.add_argument('--num-threads', type=int, default=0)
+    args = parser.parse_args()
+
+    inputs = list_sgf_files(args.input_dir)
+    job = go_data_gen.CorpusJob(inputs, args.input_dir, args.output_dir, args.num_shards,
+                                args.checkpoint_interval)
+    # Each worker takes every num_workers-th shard, so no coordination is needed.
+    shards = [shard for shard in range(args.num_shards)
+              if shard % args.num_workers == args.worker_index]
+    pending = [shard for shard in shards if not job.is_shard_complete(shard)]
+    print(f"{len(inputs)} input files, {len(shards)} shards for this worker, "
+          f"{len(shards) - len(pending)} already complete")
+
+    job.run(pending, args.num_threads)
+    print(f"Done. Shards written to {args.output_dir}")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,7 +1,9 @@
 import os
 import re
 from collections import defaultdict
-from typing import Dict, Set
+from typing import Dict
+
+import go_data_gen
 
 
 def parse_rules_string(rules_str: str) -> Dict[str, str]:
@@ -23,82 +25,47 @@ def parse_rules_string(rules_str: str) -> Dict[str, str]:
     return rules
 
 
-def analyze_sgf_rules(file_path: str) -> Dict[str, str]:
-    """Extract rules and encore-related comments from an SGF file."""
-    try:
-        with open(file_path, 'r', encoding='utf-8') as f:
-            content = f.read()
-
-        rules = {}
-
-        # Find RU[] tag
-        rules_match = re.search(r'RU\[[^\]]*\]', content)
-        if rules_match:
-            rules.update(parse_rules_string(rules_match.group()))
-
-        # Find SZ[] tag
-        size_match = re.search(r'SZ\[([^\]]*)\]', content)
-        if size_match:
-            size = size_match.group(1)
-            if ':' in size:  # rectangular board
-                width, height = map(int, size.split(':'))
-                # Ensure larger dimension comes first
-                width, height = max(width, height), min(width, height)
-                rules['sz'] = f"{width}x{height}"
-            else:  # square board
-                rules['sz'] = f"{size}x{size}"  # Convert "19" to "19x19"
-
-        # Find HA[] tag for handicap stones
-        handicap_match = re.search(r'HA\[([^\]]*)\]', content)
-        if handicap_match:
-            handicap = handicap_match.group(1)
-            rules['handicap'] = handicap
-
-        # Find C[] tags containing "encore"
-        comment_matches = re.finditer(r'C\[([^\]]*)\]', content)
-        encore_found = False
-        for match in comment_matches:
-            comment = match.group(1)
-            if 'encore' in comment.lower():
-                # Split by comma and find the part containing 'encore'
-                parts = comment.split(',')
-                for part in parts:
-                    if 'encore' in part.lower():
-                        rules['comment'] = part.strip()
-                        encore_found = True
-                        break
-                if encore_found:
-                    break
-
-        if not encore_found:
-            rules['comment'] = "no encore in comment or no comment"
-
-        return rules
-    except Exception as e:
-        print(f"Error processing {file_path}: {str(e)}")
-
-    return {}
-
-
-def collect_sgf_rules_statistics(directory: str) -> Dict[str, Dict[str, int]]:
-    """Collect statistics about rules usage across all SGF files in a directory."""
+def metadata_to_rules(metadata) -> Dict[str, str]:
+    """Convert scanned SGF metadata into a dictionary of rule components."""
+    rules = parse_rules_string(metadata.rules)
+
+    width, height = metadata.board_size.x, metadata.board_size.y
+    # Ensure larger dimension comes first
+    width, height = max(width, height), min(width, height)
+    rules['sz'] = f"{width}x{height}"
+
+    rules['handicap'] = str(metadata.num_handicap_stones)
+    rules['encore'] = "began in encore phase" if metadata.began_in_encore else "no encore"
+
+    return rules
+
+
+def collect_sgf_rules_statistics(directory: str, index_path: str = None):
+    """Collect statistics about rules usage across all SGF files in a directory.
+
+    If `index_path` points to an existing index, it is used instead of scanning the directory.
+    Otherwise the directory is scanned and the index is written for later runs.
+    """
+    if index_path and os.path.exists(index_path):
+        entries = go_data_gen.read_sgf_index(index_path)
+    else:
+        entries = go_data_gen.scan_sgf_directory(directory)
+        if index_path:
+            go_data_gen.write_sgf_index(index_path, entries)
+
     # Dictionary to store statistics for each rule type
     stats = defaultdict(lambda: defaultdict(int))
-    total_files = 0
+    total_files = len(entries)
     files_with_rules = 0
 
-    # Walk through directory
-    for root, _, files in os.walk(directory):
-        for file in files:
-            if file.lower().endswith('.sgf'):
-                total_files += 1
-                file_path = os.path.join(root, file)
-
-                rules = analyze_sgf_rules(file_path)
-                if rules:
-                    files_with_rules += 1
-                    for key, value in rules.items():
-                        stats[key][value] += 1
+    for metadata in entries:
+        if not metadata.is_valid:
+            print(f"Error processing {metadata.path}")
+            continue
+        if metadata.rules:
+            files_with_rules += 1
+        for key, value in metadata_to_rules(metadata).items():
+            stats[key][value] += 1
 
     return stats, total_files, files_with_rules
 
@@ -125,8 +92,8 @@ def print_statistics(stats: Dict[str, Dict[str, int]], total_files: int, files_w
                 key=lambda x: tuple(map(int, x[0].split('x'))),
                 reverse=True
             )
-        elif rule_type == 'comment':
-            # Sort comments by count in descending order
+        elif rule_type == 'encore':
+            # Sort by count in descending order
             sorted_items = sorted(values.items(), key=lambda x: (-x[1], x[0]))
         else:
             sorted_items = sorted(values.items())
@@ -140,17 +107,18 @@ def print_statistics(stats: Dict[str, Dict[str, int]], total_files: int, files_w
 def main():
     import sys
 
-    if len(sys.argv) != 2:
-        print("Usage: python sgf_rules_statistics.py <directory>")
+    if len(sys.argv) not in (2, 3):
+        print("Usage: python sgf_statistics.py <directory> [index_file]")
         sys.exit(1)
 
     directory = sys.argv[1]
+    index_path = sys.argv[2] if len(sys.argv) == 3 else None
     if not os.path.isdir(directory):
         print(f"Error: {directory} is not a valid directory")
         sys.exit(1)
 
     stats, total_files, files_with_rules = collect_sgf_rules_statistics(
-        directory)
+        directory, index_path)
     print_statistics(stats, total_files, files_with_rules)
 
 
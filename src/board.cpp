@@ -1,46 +1,69 @@
 #include "go_data_gen/board.hpp"
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
-#include <random>
+#include <set>
 #include <sstream>
+#include <stdexcept>
 
-#define FOR_EACH_NEIGHBOR(coord, n_coord, func) \
-    (n_coord) = {coord.x - 1, coord.y};         \
-    func;                                       \
-    (n_coord) = {coord.x + 1, coord.y};         \
-    func;                                       \
-    (n_coord) = {coord.x, coord.y - 1};         \
-    func;                                       \
-    (n_coord) = {coord.x, coord.y + 1};         \
-    func;
+#include "go_data_gen/feature_expand.hpp"
+#include "go_data_gen/feature_set.hpp"
+#include "go_data_gen/zobrist.hpp"
 
 namespace {
 
+using Point = go_data_gen::Board::Point;
+
 // +2 for color to play for situational superko
 static constexpr size_t zobrist_hashes_size =
     go_data_gen::Board::max_board_size * go_data_gen::Board::max_board_size * 2 + 2;
-uint64_t zobrist_hashes[zobrist_hashes_size];
-
-void init_zobrist() {
-    static bool initialized = false;
-    if (!initialized) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<uint64_t> dis(0, std::numeric_limits<uint64_t>::max());
-        for (size_t i = 0; i < zobrist_hashes_size; ++i) {
-            zobrist_hashes[i] = dis(gen);
+// Generated at compile time, so the table is constant-initialized before any Board can be
+// constructed and hashes are stable across processes.
+std::array<uint64_t, zobrist_hashes_size> zobrist_hashes =
+    go_data_gen::make_zobrist_table<zobrist_hashes_size>(go_data_gen::default_zobrist_seed);
+uint64_t zobrist_seed = go_data_gen::default_zobrist_seed;
+
+uint64_t coord_color_to_zobrist(go_data_gen::Vec2 coord, go_data_gen::Color color) {
+    assert(color == go_data_gen::Color::Black || color == go_data_gen::Color::White);
+    return zobrist_hashes[(color == go_data_gen::Color::Black ? 0 : 1) +
+                          (coord.x + coord.y * go_data_gen::Board::max_board_size) * 2];
+}
+
+// Index of the black hash of each point in the zobrist table. White follows at the next index.
+constexpr std::array<uint16_t, go_data_gen::Board::num_points> make_zobrist_indices() {
+    using go_data_gen::Board;
+    std::array<uint16_t, Board::num_points> indices{};
+    for (int y = Board::padding; y < Board::padding + Board::max_board_size; ++y) {
+        for (int x = Board::padding; x < Board::padding + Board::max_board_size; ++x) {
+            indices[Board::to_point(x, y)] =
+                ((x - Board::padding) + (y - Board::padding) * Board::max_board_size) * 2;
         }
-        initialized = true;
     }
+    return indices;
 }
+constexpr std::array<uint16_t, go_data_gen::Board::num_points> zobrist_indices =
+    make_zobrist_indices();
 
-uint64_t mem_coord_color_to_zobrist(go_data_gen::Vec2 mem_coord, go_data_gen::Color color) {
+uint64_t point_color_to_zobrist(Point point, go_data_gen::Color color) {
     assert(color == go_data_gen::Color::Black || color == go_data_gen::Color::White);
-    mem_coord.x -= go_data_gen::Board::padding;
-    mem_coord.y -= go_data_gen::Board::padding;
-    return zobrist_hashes[(color == go_data_gen::Color::Black ? 0 : 1) +
-                          (mem_coord.x + mem_coord.y * go_data_gen::Board::max_board_size) * 2];
+    return zobrist_hashes[zobrist_indices[point] + (color == go_data_gen::Color::Black ? 0 : 1)];
+}
+
+// Maps an (unpadded) coordinate to its image under symmetry `sym` on a board of size `size`.
+// The transposition is applied first, so the flips use the dimensions of the transposed board.
+go_data_gen::Vec2 apply_symmetry(go_data_gen::Vec2 coord, go_data_gen::Vec2 size, int sym) {
+    if (sym & 1) {
+        std::swap(coord.x, coord.y);
+        std::swap(size.x, size.y);
+    }
+    if (sym & 2) {
+        coord.x = size.x - 1 - coord.x;
+    }
+    if (sym & 4) {
+        coord.y = size.y - 1 - coord.y;
+    }
+    return coord;
 }
 
 uint64_t color_to_zobrist(go_data_gen::Color color) {
@@ -52,6 +75,13 @@ uint64_t color_to_zobrist(go_data_gen::Color color) {
 
 namespace go_data_gen {
 
+void set_zobrist_seed(uint64_t seed) {
+    zobrist_seed = seed;
+    zobrist_hashes = make_zobrist_table<zobrist_hashes_size>(seed);
+}
+
+uint64_t get_zobrist_seed() { return zobrist_seed; }
+
 Board::Board(Vec2 _board_size, float _komi, Ruleset _ruleset, int _num_handicap_stones)
     : board_size{_board_size},
       komi{_komi},
@@ -59,35 +89,59 @@ Board::Board(Vec2 _board_size, float _komi, Ruleset _ruleset, int _num_handicap_
       num_handicap_stones{_num_handicap_stones} {
     assert(board_size.x <= max_board_size && board_size.y <= max_board_size &&
            "Maximum size exceeded");
-    init_zobrist();
     reset();
 }
 
-void Board::reset() {
-    for (int y = 0; y < data_size; ++y) {
-        for (int x = 0; x < data_size; ++x) {
-            board[y][x] = static_cast<char>(OffBoard);
-            if (y >= padding && x >= padding && y < padding + board_size.y &&
-                x < padding + board_size.x) {
-                board[y][x] = static_cast<char>(Empty);
-            }
+void Board::reset(Vec2 _board_size, float _komi, Ruleset _ruleset, int _num_handicap_stones) {
+    assert(_board_size.x <= max_board_size && _board_size.y <= max_board_size &&
+           "Maximum size exceeded");
+    board_size = _board_size;
+    komi = _komi;
+    ruleset = _ruleset;
+    num_handicap_stones = _num_handicap_stones;
+    reset();
+}
+
+size_t Board::get_memory_usage() const {
+    size_t usage = sizeof(Board) + history.capacity() * sizeof(Move) +
+                   zobrist_history.capacity() * sizeof(uint64_t);
+    for (const auto& stones : group) {
+        usage += stones.capacity() * sizeof(Point);
+    }
+    return usage;
+}
 
-            parent[y][x] = {x, y};
-            group[y][x].clear();
-            liberties[y][x].clear();
+void Board::reset() {
+    board.fill(static_cast<char>(OffBoard));
+    num_on_board_points = 0;
+    for (int y = padding; y < padding + board_size.y; ++y) {
+        for (int x = padding; x < padding + board_size.x; ++x) {
+            board[to_point(x, y)] = static_cast<char>(Empty);
+            on_board_points[num_on_board_points++] = to_point(x, y);
         }
     }
+    for (int point = 0; point < num_points; ++point) {
+        parent[point] = point;
+        group[point].clear();
+        liberties[point].clear();
+    }
     history.clear();
     first_player_to_pass = Empty;
     num_captures = 0;
     num_setup_stones = 0;
 
+    stone_history_head = 0;
+    num_stone_history = 1;
+    stone_history[0] = StoneRows{};
+
     zobrist = 0;
+    symmetric_zobrist.fill(0);
+    zobrist_history.clear();
     if (ruleset.ko_rule == KoRule::Simple || ruleset.ko_rule == KoRule::SituationalSuperko) {
         // On an empty board, black gets to play first.
-        zobrist_history = std::vector<uint64_t>{zobrist ^ color_to_zobrist(Black)};
+        zobrist_history.push_back(zobrist ^ color_to_zobrist(Black));
     } else {
-        zobrist_history = std::vector<uint64_t>{zobrist};
+        zobrist_history.push_back(zobrist);
     }
 }
 
@@ -96,56 +150,65 @@ void Board::setup_move(Move move) {
     assert(move.color != OffBoard);
 
     // Shift coordinate to account for padding of data fields.
-    const Vec2 mem_coord{move.coord.x + padding, move.coord.y + padding};
+    const int x = move.coord.x + padding;
+    const int y = move.coord.y + padding;
+    const Point point = to_point(x, y);
 
-    if ((move.color == Black || move.color == White) && board[mem_coord.y][mem_coord.x] == Empty) {
+    if ((move.color == Black || move.color == White) && board[point] == Empty) {
         ++num_setup_stones;
-    } else if (move.color == Empty && (board[mem_coord.y][mem_coord.x] == Black ||
-                                       board[mem_coord.y][mem_coord.x] == White)) {
+    } else if (move.color == Empty && (board[point] == Black || board[point] == White)) {
         --num_setup_stones;
     }
 
-    board[mem_coord.y][mem_coord.x] = static_cast<char>(move.color);
+    const auto previous_color = static_cast<Color>(board[point]);
+    if (previous_color == Black || previous_color == White) {
+        toggle_symmetric_zobrist(point, previous_color);
+    }
+    if (move.color == Black || move.color == White) {
+        toggle_symmetric_zobrist(point, move.color);
+    }
+
+    board[point] = static_cast<char>(move.color);
 
+    auto& stone_rows = stone_history[stone_history_head];
+    stone_rows[0][y] &= ~(1u << x);
+    stone_rows[1][y] &= ~(1u << x);
     if (move.color == Black || move.color == White) {
-        // Initialize new group
-        parent[mem_coord.y][mem_coord.x] = mem_coord;
-        group[mem_coord.y][mem_coord.x].clear();
-        group[mem_coord.y][mem_coord.x].push_back(mem_coord);
-        liberties[mem_coord.y][mem_coord.x].clear();
+        stone_rows[move.color - Black][y] |= 1u << x;
     }
 
-    Vec2 neighbor, root;
+    if (move.color == Black || move.color == White) {
+        // Initialize new group
+        parent[point] = point;
+        group[point].clear();
+        group[point].push_back(point);
+        liberties[point].clear();
+    }
 
     // Update liberties and connect groups.
     // Captures are not handled.
-    Color neighbor_color;
-    FOR_EACH_NEIGHBOR(
-        mem_coord, neighbor,  //
-        neighbor_color = static_cast<Color>(board[neighbor.y][neighbor.x]);
+    for (const int offset : neighbor_offsets) {
+        const Point neighbor = point + offset;
+        const auto neighbor_color = static_cast<Color>(board[neighbor]);
         if (move.color == Empty) {
             if (neighbor_color == Black || neighbor_color == White) {
-                root = find(neighbor);
-                liberties[root.y][root.x].insert(mem_coord);
+                liberties[find(neighbor)].insert(point);
             }
         } else {
             const auto opp_col = opposite(move.color);
             if (neighbor_color == Empty) {
-                root = find(mem_coord);
-                liberties[root.y][root.x].insert(neighbor);
+                liberties[find(point)].insert(neighbor);
             } else if (neighbor_color == move.color) {
-                root = find(neighbor);
-                liberties[root.y][root.x].erase(mem_coord);
-                unite(mem_coord, neighbor);
+                liberties[find(neighbor)].erase(point);
+                unite(point, neighbor);
             } else if (neighbor_color == opp_col) {
-                root = find(neighbor);
-                liberties[root.y][root.x].erase(mem_coord);
+                liberties[find(neighbor)].erase(point);
             }
-        }  //
-    )
+        }
+    }
 
     // Assert setup move is not suicidal
-    assert(move.color == Empty || liberties[find(mem_coord).y][find(mem_coord).x].size() > 0);
+    assert(move.color == Empty || liberties[find(point)].size() > 0);
 }
 
 MoveLegality Board::get_move_legality(Move move) {
@@ -157,78 +220,167 @@ MoveLegality Board::get_move_legality(Move move) {
     }
 
     // Shift coordinate to account for padding of data fields.
-    const Vec2 mem_coord{move.coord.x + padding, move.coord.y + padding};
+    const Point point = to_point(move.coord.x + padding, move.coord.y + padding);
 
     // Board must be empty
-    if (static_cast<Color>(board[mem_coord.y][mem_coord.x]) != Empty) {
+    if (static_cast<Color>(board[point]) != Empty) {
         return MoveLegality::NonEmpty;
     }
 
-    auto new_zobrist = zobrist;
+    return get_move_legality(point, move.color, get_neighbor_groups(point, move.color));
+}
 
-    const auto opp_col = opposite(move.color);
+Board::NeighborGroups Board::get_neighbor_groups(Point point, Color color) {
+    NeighborGroups neighbors;
+    for (const int offset : neighbor_offsets) {
+        const Point neighbor = point + offset;
+        const auto neighbor_color = static_cast<Color>(board[neighbor]);
+        if (neighbor_color == Empty) {
+            neighbors.empty[neighbors.num_empty++] = neighbor;
+        } else if (neighbor_color == color) {
+            const Point root = find(neighbor);
+            if (std::find(neighbors.own_roots.begin(),
+                          neighbors.own_roots.begin() + neighbors.num_own,
+                          root) == neighbors.own_roots.begin() + neighbors.num_own) {
+                neighbors.own_roots[neighbors.num_own++] = root;
+            }
+        } else if (neighbor_color != OffBoard) {
+            const Point root = find(neighbor);
+            if (std::find(neighbors.opp_roots.begin(),
+                          neighbors.opp_roots.begin() + neighbors.num_opp,
+                          root) == neighbors.opp_roots.begin() + neighbors.num_opp) {
+                neighbors.opp_roots[neighbors.num_opp++] = root;
+            }
+        }
+    }
+    return neighbors;
+}
 
+MoveLegality Board::get_move_legality(Point point, Color color, const NeighborGroups& neighbors) {
     // Simulate playing stone.
-    new_zobrist ^= mem_coord_color_to_zobrist(mem_coord, move.color);
-    // Figure out liberties and captured groups
-    // We need to do it in two passes to avoid simulating a removal of the same group multiple times
-    // with even parity, which would cancel out the zobrist hash changes.
-    std::vector<Vec2> neighbors_of_same_color;
-    std::set<Vec2> resulting_liberties;
-    std::set<Vec2> captures;
-    bool connects_to_own_group = false;
-    Vec2 neighbor, root;
-    Color neighbor_color;
-    FOR_EACH_NEIGHBOR(
-        mem_coord, neighbor,  //
-        neighbor_color = static_cast<Color>(board[neighbor.y][neighbor.x]);
-        if (neighbor_color == Empty) {
-            resulting_liberties.insert(neighbor);
-        } else if (neighbor_color == move.color) {
-            connects_to_own_group = true;
-            root = find(neighbor);
-            resulting_liberties.insert(liberties[root.y][root.x].begin(),
-                                       liberties[root.y][root.x].end());
-            neighbors_of_same_color.push_back(neighbor);
-        } else if (neighbor_color == opp_col) {
-            root = find(neighbor);
-            if (liberties[root.y][root.x].size() == 1) {
-                captures.insert(root);
+    auto new_zobrist = zobrist ^ point_color_to_zobrist(point, color);
+
+    // Opponent groups in atari are captured. The roots are distinct, so no group is removed
+    // twice, which would cancel out the zobrist hash changes.
+    bool captures = false;
+    for (int i = 0; i < neighbors.num_opp; ++i) {
+        const Point root = neighbors.opp_roots[i];
+        if (liberties[root].size() == 1) {
+            captures = true;
+            for (const Point stone : group[root]) {
+                new_zobrist ^= point_color_to_zobrist(stone, opposite(color));
             }
-        }  //
-    )
-
-    // Check for suicide
-    if (captures.empty()) {
-        // Account for this move stealing last liberty of neighboring group without adding any
-        resulting_liberties.erase(mem_coord);
-        // If suicide is disallowed or if move would be single-stone suicide, move is illegal.
-        if (resulting_liberties.empty()) {
-            if (ruleset.suicide_rule == SuicideRule::Disallowed || !connects_to_own_group) {
+        }
+    }
+
+    // Check for suicide: Without captures, the move needs an empty neighbor or an own group
+    // with a liberty besides this point.
+    if (!captures && neighbors.num_empty == 0) {
+        bool has_liberty = false;
+        for (int i = 0; i < neighbors.num_own; ++i) {
+            has_liberty |= liberties[neighbors.own_roots[i]].size() > 1;
+        }
+        if (!has_liberty) {
+            // If suicide is disallowed or if move would be single-stone suicide, move is illegal.
+            if (ruleset.suicide_rule == SuicideRule::Disallowed || neighbors.num_own == 0) {
                 return MoveLegality::Suicidal;
             }
-            // If suicidal move is legal, simulate removing group.
-            // Undo the move directly, since we don't want to modify the board state.
-            new_zobrist ^= mem_coord_color_to_zobrist(mem_coord, move.color);
-            for (const auto& neighbor : neighbors_of_same_color) {
-                captures.insert(find(neighbor));
+            // If suicidal move is legal, simulate removing the stone and the connected groups.
+            new_zobrist ^= point_color_to_zobrist(point, color);
+            for (int i = 0; i < neighbors.num_own; ++i) {
+                for (const Point stone : group[neighbors.own_roots[i]]) {
+                    new_zobrist ^= point_color_to_zobrist(stone, color);
+                }
             }
         }
     }
 
-    // Calculate zobrist if captured groups are removed
-    for (auto capture : captures) {
-        for (auto stone : group[capture.y][capture.x]) {
-            new_zobrist ^=
-                mem_coord_color_to_zobrist(stone, static_cast<Color>(board[stone.y][stone.x]));
+    return get_ko_legality(new_zobrist, color);
+}
+
+Board::MoveLookahead Board::get_move_lookahead(Move move) {
+    assert(!move.is_pass);
+    const Point point = to_point(move.coord.x + padding, move.coord.y + padding);
+    return get_move_lookahead(point, move.color, get_neighbor_groups(point, move.color));
+}
+
+Board::MoveLookahead Board::get_move_lookahead(Point point, Color color,
+                                               const NeighborGroups& neighbors) {
+    MoveLookahead lookahead{};
+
+    // Distinct liberties of the resulting group, up to num_lib_planes of them.
+    std::array<Point, num_lib_planes> libs;
+    int num_libs = 0;
+    const auto add_liberty = [&](Point liberty) {
+        if (num_libs < num_lib_planes && liberty != point &&
+            std::find(libs.begin(), libs.begin() + num_libs, liberty) ==
+                libs.begin() + num_libs) {
+            libs[num_libs++] = liberty;
+        }
+    };
+    for (int i = 0; i < neighbors.num_empty; ++i) {
+        add_liberty(neighbors.empty[i]);
+    }
+    bool in_atari = false;
+    for (int i = 0; i < neighbors.num_own; ++i) {
+        const auto& root_liberties = liberties[neighbors.own_roots[i]];
+        in_atari |= root_liberties.size() == 1;
+        for (auto it = root_liberties.begin();
+             it != root_liberties.end() && num_libs < num_lib_planes; ++it) {
+            add_liberty(*it);
         }
     }
 
-    if (ruleset.ko_rule == KoRule::Simple || ruleset.ko_rule == KoRule::SituationalSuperko) {
-        // Simulate switching color-to-play.
-        new_zobrist ^= color_to_zobrist(opp_col);
+    // Captured stones next to the resulting group become its liberties.
+    const auto is_in_group = [&](Point other) {
+        if (other == point) {
+            return true;
+        }
+        if (static_cast<Color>(board[other]) != color) {
+            return false;
+        }
+        const Point root = find(other);
+        return std::find(neighbors.own_roots.begin(),
+                         neighbors.own_roots.begin() + neighbors.num_own,
+                         root) != neighbors.own_roots.begin() + neighbors.num_own;
+    };
+    for (int i = 0; i < neighbors.num_opp; ++i) {
+        const Point root = neighbors.opp_roots[i];
+        if (liberties[root].size() != 1) {
+            continue;
+        }
+        lookahead.num_captures += group[root].size();
+        for (const Point stone : group[root]) {
+            if (num_libs == num_lib_planes) {
+                break;
+            }
+            if (std::any_of(neighbor_offsets.begin(), neighbor_offsets.end(),
+                            [&](int offset) { return is_in_group(stone + offset); })) {
+                add_liberty(stone);
+            }
+        }
     }
 
+    lookahead.num_liberties = num_libs;
+    lookahead.is_atari_escape = in_atari && num_libs >= 2;
+    return lookahead;
+}
+
+void Board::set_lookahead_bits(const MoveLookahead& lookahead, uint32_t bit, uint32_t* rows) {
+    if (lookahead.num_liberties > 0) {
+        rows[lookahead_lib_plane_index - lookahead_plane_index + lookahead.num_liberties - 1] |=
+            bit;
+    }
+    rows[capture_plane_index - lookahead_plane_index] |= lookahead.num_captures > 0 ? bit : 0;
+    rows[self_atari_plane_index - lookahead_plane_index] |=
+        (lookahead.num_liberties == 1 && lookahead.num_captures == 0) ? bit : 0;
+    rows[atari_escape_plane_index - lookahead_plane_index] |=
+        lookahead.is_atari_escape ? bit : 0;
+}
+
+MoveLegality Board::get_ko_legality(uint64_t new_zobrist, Color color) const {
+    new_zobrist = get_history_hash(new_zobrist, color);
+
     // Check for ko
     if (ruleset.ko_rule == KoRule::Simple) {
         // Simple ko: Move would repeat state two moves ago.
@@ -253,86 +405,106 @@ MoveLegality Board::get_move_legality(Move move) {
     return MoveLegality::Legal;
 }
 
+uint64_t Board::get_history_hash(uint64_t new_zobrist, Color color) const {
+    if (ruleset.ko_rule == KoRule::Simple || ruleset.ko_rule == KoRule::SituationalSuperko) {
+        // Simulate switching color-to-play.
+        new_zobrist ^= color_to_zobrist(opposite(color));
+    }
+    return new_zobrist;
+}
+
+uint64_t Board::get_stone_hash(Point point, Color color) {
+    return point_color_to_zobrist(point, color);
+}
+
 bool Board::is_legal(Move move) { return get_move_legality(move) == MoveLegality::Legal; }
 
 void Board::play(Move move) {
     assert(get_move_legality(move) == MoveLegality::Legal);
 
+    // The new position starts as a copy of the current one in the stone history.
+    const int previous_head = stone_history_head;
+    stone_history_head = (stone_history_head + 1) % max_stone_history;
+    num_stone_history = std::min(num_stone_history + 1, max_stone_history);
+    auto& stone_rows = stone_history[stone_history_head];
+    stone_rows = stone_history[previous_head];
+
     const auto opp_col = opposite(move.color);
     if (!move.is_pass) {
         // Shift coordinate to account for padding of data fields.
-        const Vec2 mem_coord{move.coord.x + padding, move.coord.y + padding};
+        const Point point = to_point(move.coord.x + padding, move.coord.y + padding);
 
         // Even though this move may turn out to be suicidal, we update the board and zobrist
         // immediately to reduce branching.
-        board[mem_coord.y][mem_coord.x] = static_cast<char>(move.color);
-        zobrist ^= mem_coord_color_to_zobrist(mem_coord, move.color);
+        board[point] = static_cast<char>(move.color);
+        stone_rows[move.color - Black][point_y(point)] |= 1u << point_x(point);
+        zobrist ^= point_color_to_zobrist(point, move.color);
+        toggle_symmetric_zobrist(point, move.color);
 
         // Initialize new group
-        parent[mem_coord.y][mem_coord.x] = mem_coord;
-        group[mem_coord.y][mem_coord.x].clear();
-        group[mem_coord.y][mem_coord.x].push_back(mem_coord);
-        liberties[mem_coord.y][mem_coord.x].clear();
+        parent[point] = point;
+        group[point].clear();
+        group[point].push_back(point);
+        liberties[point].clear();
 
         // Add liberties, connect to own groups, and figure out captured groups
-        std::set<Vec2> captures;
-        Vec2 neighbor, root;
-        Color neighbor_color;
-        FOR_EACH_NEIGHBOR(
-            mem_coord, neighbor,  //
-            neighbor_color = static_cast<Color>(board[neighbor.y][neighbor.x]);
+        std::array<Point, 4> captures;
+        int num_captured_groups = 0;
+        for (const int offset : neighbor_offsets) {
+            const Point neighbor = point + offset;
+            const auto neighbor_color = static_cast<Color>(board[neighbor]);
             if (neighbor_color == Empty) {
-                root = find(mem_coord);
-                liberties[root.y][root.x].insert(neighbor);
+                liberties[find(point)].insert(neighbor);
             } else if (neighbor_color == move.color) {
-                root = find(neighbor);
-                liberties[root.y][root.x].erase(mem_coord);
-                unite(mem_coord, neighbor);
+                liberties[find(neighbor)].erase(point);
+                unite(point, neighbor);
             } else if (neighbor_color == opp_col) {
-                root = find(neighbor);
-                liberties[root.y][root.x].erase(mem_coord);
-                if (liberties[root.y][root.x].size() == 0) {
-                    captures.insert(root);
+                const Point root = find(neighbor);
+                liberties[root].erase(point);
+                if (liberties[root].empty() &&
+                    std::find(captures.begin(), captures.begin() + num_captured_groups, root) ==
+                        captures.begin() + num_captured_groups) {
+                    captures[num_captured_groups++] = root;
                 }
-            }  //
-        )
+            }
+        }
 
         // Handle suicide
-        if (captures.empty()) {
-            root = find(mem_coord);
-            if (liberties[root.y][root.x].empty()) {
-                captures.insert(root);
+        if (num_captured_groups == 0) {
+            const Point root = find(point);
+            if (liberties[root].empty()) {
+                captures[num_captured_groups++] = root;
             }
         }
 
         // Handle captures
-        for (auto capture : captures) {
-            const auto removed_color = static_cast<Color>(board[capture.y][capture.x]);
+        for (int i = 0; i < num_captured_groups; ++i) {
+            const Point capture = captures[i];
+            const auto removed_color = static_cast<Color>(board[capture]);
             const auto opp_rem_col = opposite(removed_color);
             if (removed_color == Black) {
-                num_captures -= group[capture.y][capture.x].size();
+                num_captures -= group[capture].size();
             } else {
-                num_captures += group[capture.y][capture.x].size();
+                num_captures += group[capture].size();
             }
-            for (auto stone : group[capture.y][capture.x]) {
-                zobrist ^= mem_coord_color_to_zobrist(stone, removed_color);
-                board[stone.y][stone.x] = static_cast<char>(Empty);
-                FOR_EACH_NEIGHBOR(
-                    stone, neighbor,  //
-                    neighbor_color = static_cast<Color>(board[neighbor.y][neighbor.x]);
-                    if (neighbor_color == opp_rem_col) {
+            for (const Point stone : group[capture]) {
+                zobrist ^= point_color_to_zobrist(stone, removed_color);
+                toggle_symmetric_zobrist(stone, removed_color);
+                board[stone] = static_cast<char>(Empty);
+                stone_rows[removed_color - Black][point_y(stone)] &= ~(1u << point_x(stone));
+                for (const int offset : neighbor_offsets) {
+                    const Point neighbor = stone + offset;
+                    if (static_cast<Color>(board[neighbor]) == opp_rem_col) {
                         // Capturing a group frees liberties for the opposite color.
-                        root = find(neighbor);
-                        liberties[root.y][root.x].insert(stone);
-                    }  //
-                )
+                        liberties[find(neighbor)].insert(stone);
+                    }
+                }
 #ifndef NDEBUG
                 // We don't need to maintain other data structures here.
                 // For debugging, clean up anyway.
-                parent[stone.y][stone.x].x = stone.x;
-                parent[stone.y][stone.x].y = stone.y;
-                group[stone.y][stone.x].clear();
-                liberties[stone.y][stone.x].clear();
+                parent[stone] = stone;
+                group[stone].clear();
+                liberties[stone].clear();
 #endif
             }
         }
@@ -384,160 +556,283 @@ void Board::play(Move move) {
     history.push_back(move);
 }
 
-Board::StackedFeaturePlanes Board::get_feature_planes(Color to_play) {
-    static constexpr int num_planes_before_lib_planes = 5;
-    static constexpr int num_lib_planes = 4;
-    static constexpr int num_planes_before_history_planes =
-        num_planes_before_lib_planes + 2 * num_lib_planes;
-    static constexpr int num_history_planes = 5;
-    static_assert(num_feature_planes == num_planes_before_history_planes + num_history_planes);
-
-    const auto opp_col = opposite(to_play);
-
-    // Zero-initialize.
-    StackedFeaturePlanes result{};
-    for (int y = 0; y < Board::data_size; ++y) {
-        for (int x = 0; x < Board::data_size; ++x) {
-            const auto move_legality =
-                get_move_legality(Move{to_play, false, {x - padding, y - padding}});
-
-            // Legal to play
-            result[y][x][legal_move_plane_index] =
-                static_cast<float>(move_legality == MoveLegality::Legal);
-            // Is on-board
-            result[y][x][on_board_plane_index] =
-                static_cast<float>(static_cast<Color>(board[y][x]) != OffBoard);
-
-            // Own color
-            result[y][x][2] = static_cast<float>(static_cast<Color>(board[y][x]) == to_play);
-            // Opponent color
-            result[y][x][3] = static_cast<float>(static_cast<Color>(board[y][x]) == opp_col);
-
-            // Mark ko / superko
-            result[y][x][4] = static_cast<float>(move_legality == MoveLegality::Ko);
-
-            // Liberties of own and opponent groups
-            if (static_cast<Color>(board[y][x]) == Black ||
-                static_cast<Color>(board[y][x]) == White) {
-                const auto root = find(Vec2{x, y});
-                const int num_libs = liberties[root.y][root.x].size();
-                if (static_cast<Color>(board[y][x]) == to_play) {
-                    result[y][x][num_planes_before_lib_planes + std::min(num_libs, num_lib_planes) -
-                                 1] = 1.0;
-                } else {
-                    result[y][x][num_planes_before_lib_planes + num_lib_planes +
-                                 std::min(num_libs, num_lib_planes) - 1] = 1.0;
-                }
-            }
+void Board::play_moves(const PackedMove* moves, size_t num_moves) {
+    for (size_t i = 0; i < num_moves; ++i) {
+        play_checked(moves[i].to_move(), i);
+    }
+}
 
-            // TODO: pass-alive areas, ladder status.
-        }
+void Board::play_checked(Move move, size_t index) {
+    const bool is_valid =
+        (move.color == Black || move.color == White) &&
+        (history.empty() || move.color == opposite(history.back().color)) &&
+        (move.is_pass || (move.coord.x >= 0 && move.coord.x < board_size.x && move.coord.y >= 0 &&
+                          move.coord.y < board_size.y));
+    if (!is_valid || get_move_legality(move) != MoveLegality::Legal) {
+        throw std::runtime_error("Invalid or illegal move at index " + std::to_string(index));
     }
+    play(move);
+}
 
-    // History of moves. dist = 0 implies the move just played.
-    // dist = 1 implies the 2nd-last move played, and so on.
-    for (int dist = 0; dist < num_history_planes; ++dist) {
-        if (dist < history.size()) {
-            const auto& history_move = history.rbegin()[dist];
-            if (!history_move.is_pass) {
-                result[history_move.coord.y + padding][history_move.coord.x + padding]
-                      [num_planes_before_history_planes + dist] = 1.0;
-            }
+void Board::get_group_data(int8_t* group_ids, int8_t* group_sizes, int8_t* liberty_counts) {
+    static constexpr int max_value = 127;
+    // Group id by root. Only the roots of this position are set.
+    std::array<int16_t, num_points> root_ids;
+    root_ids.fill(-1);
+    int num_groups = 0;
+    for (int i = 0; i < num_on_board_points; ++i) {
+        const Point point = on_board_points[i];
+        const auto color = static_cast<Color>(board[point]);
+        if (color != Black && color != White) {
+            group_ids[i] = -1;
+            group_sizes[i] = 0;
+            liberty_counts[i] = 0;
+            continue;
+        }
+        const Point root = find(point);
+        if (root_ids[root] < 0) {
+            root_ids[root] = num_groups++;
         }
+        group_ids[i] = std::min<int>(root_ids[root], max_value);
+        group_sizes[i] = std::min<int>(group[root].size(), max_value);
+        liberty_counts[i] = std::min<int>(liberties[root].size(), max_value);
     }
-
-    return result;
 }
 
-Board::FeatureVector Board::get_feature_scalars(Color to_play) {
-    static constexpr int num_features_before_pass_features = 5;
-    static constexpr int num_pass_features = 3;
-    static_assert(num_feature_scalars == num_features_before_pass_features + num_pass_features);
-
-    // Zero-initialize.
-    FeatureVector result{};
-
-    // Extra points that the current player gets.
-    float points_normalization_factor = 1.0f / 15.0f;
-    float bonus = komi;  // From White's perspective
-    if (ruleset.first_player_pass_bonus_rule == FirstPlayerPassBonusRule::Bonus) {
-        if (first_player_to_pass == Black) {
-            bonus -= 0.5f;
-        } else if (first_player_to_pass == White) {
-            bonus += 0.5f;
+void Board::get_game_group_data(const PackedMove* moves, size_t num_moves, int8_t* group_ids,
+                                int8_t* group_sizes, int8_t* liberty_counts) {
+    // On-board points are in row-major order, so position i starts at i * num_on_board_points.
+    for (size_t i = 0;; ++i) {
+        const size_t offset = i * num_on_board_points;
+        get_group_data(group_ids + offset, group_sizes + offset, liberty_counts + offset);
+        if (i == num_moves) {
+            break;
         }
+        play_checked(moves[i].to_move(), i);
     }
-    result[0] = (to_play == White ? bonus : -bonus) * points_normalization_factor;
-
-    // There is a superko move
-    result[1] = static_cast<float>(any_ko_move(to_play));
+}
 
-    // Scoring is area-based or territory-based
-    if (ruleset.scoring_rule == ScoringRule::Area) {
-        result[2] = 0.0f;
-    } else if (ruleset.scoring_rule == ScoringRule::Territory) {
-        result[2] = 1.0f;
+void Board::toggle_symmetric_zobrist(Point point, Color color) {
+    const Vec2 coord{point_x(point) - padding, point_y(point) - padding};
+    for (int sym = 0; sym < num_symmetries; ++sym) {
+        symmetric_zobrist[sym] ^=
+            coord_color_to_zobrist(apply_symmetry(coord, board_size, sym), color);
     }
+}
+
+uint64_t Board::get_canonical_hash(Color to_play) const {
+    return *std::min_element(symmetric_zobrist.begin(), symmetric_zobrist.end()) ^
+           get_context_hash(to_play);
+}
 
-    // Stone capture difference from current player's perspective, normalized.
-    // num_captures is positive if black captured more stones than white.
-    result[3] = (to_play == White ? -1.0f : 1.0f) * static_cast<float>(num_captures) *
-                points_normalization_factor;
+uint64_t Board::get_context_hash(Color to_play) const {
+    // Mix in everything else that makes positions differ for training purposes.
+    // Transposed board sizes are equivalent, so only the sorted dimensions are included.
+    uint32_t komi_bits;
+    std::memcpy(&komi_bits, &komi, sizeof(komi_bits));
+    uint64_t context = komi_bits;
+    context |= static_cast<uint64_t>(ruleset.ko_rule) << 32;
+    context |= static_cast<uint64_t>(ruleset.suicide_rule) << 34;
+    context |= static_cast<uint64_t>(ruleset.scoring_rule) << 35;
+    context |= static_cast<uint64_t>(ruleset.tax_rule) << 36;
+    context |= static_cast<uint64_t>(ruleset.first_player_pass_bonus_rule) << 38;
+    context |= static_cast<uint64_t>(to_play) << 39;
+    context |= static_cast<uint64_t>(std::min(board_size.x, board_size.y)) << 41;
+    context |= static_cast<uint64_t>(std::max(board_size.x, board_size.y)) << 46;
+    return splitmix64(context);
+}
 
-    // Stage of the game as ratio of moves played over board size
-    result[4] =
-        static_cast<float>(num_setup_stones + history.size()) / (board_size.x * board_size.y);
+Board::FeaturePlaneRows Board::get_feature_plane_rows(Color to_play) {
+    return DefaultFeaturePlanes::get_plane_rows(*this, to_play);
+}
+
+void Board::get_features(Color to_play, FeaturePlaneRows& rows, FeatureVector& scalars) {
+    DefaultFeatures::compute(*this, to_play, rows, scalars);
+}
 
-    // N-last move was pass
-    for (int dist = 0; dist < num_pass_features; ++dist) {
-        if (dist < history.size()) {
-            const auto& history_move = history.rbegin()[dist];
-            result[num_features_before_pass_features + dist] =
-                static_cast<float>(history_move.is_pass);
+void Board::get_move_rows(Color to_play, bool with_lookahead, MoveRows& rows) {
+    static_assert(data_size <= 32, "Rows must fit into 32 bits");
+
+    rows.legal = {};
+    rows.ko = {};
+    rows.lookahead = {};
+    for (int i = 0; i < num_on_board_points; ++i) {
+        const Point point = on_board_points[i];
+        if (static_cast<Color>(board[point]) != Empty) {
+            continue;
+        }
+        // Legality and lookahead share the analysis of the neighboring groups.
+        const NeighborGroups neighbors = get_neighbor_groups(point, to_play);
+        const auto move_legality = get_move_legality(point, to_play, neighbors);
+        const int y = point_y(point);
+        const uint32_t bit = 1u << point_x(point);
+        if (move_legality == MoveLegality::Legal) {
+            rows.legal[y] |= bit;
+            if (with_lookahead) {
+                set_lookahead_bits(get_move_lookahead(point, to_play, neighbors), bit,
+                                   rows.lookahead[y].data());
+            }
+        } else if (move_legality == MoveLegality::Ko) {
+            rows.ko[y] |= bit;
         }
     }
+}
 
+void Board::get_stone_history_rows(Color to_play, int num_positions, uint32_t* rows) const {
+    if (num_positions < 1 || num_positions > max_stone_history) {
+        throw std::runtime_error("Number of history positions must be in [1, " +
+                                 std::to_string(max_stone_history) + "]");
+    }
+    const int num_planes = 2 * num_positions;
+    const int own = to_play - Black;
+    for (int t = 0; t < num_positions; ++t) {
+        if (t >= num_stone_history) {
+            for (int y = 0; y < data_size; ++y) {
+                rows[y * num_planes + 2 * t] = 0;
+                rows[y * num_planes + 2 * t + 1] = 0;
+            }
+            continue;
+        }
+        const auto& stone_rows =
+            stone_history[(stone_history_head - t + max_stone_history) % max_stone_history];
+        for (int y = 0; y < data_size; ++y) {
+            rows[y * num_planes + 2 * t] = stone_rows[own][y];
+            rows[y * num_planes + 2 * t + 1] = stone_rows[1 - own][y];
+        }
+    }
+}
+
+Board::StackedFeaturePlanes Board::get_feature_planes(Color to_play) {
+    const auto rows = get_feature_plane_rows(to_play);
+    StackedFeaturePlanes result;
+    expand_rows_hwc(&rows[0][0], data_size, data_size, num_feature_planes, &result[0][0][0]);
     return result;
 }
 
-Vec2 Board::find(Vec2 coord) {
-    while (parent[coord.y][coord.x] != coord) {
-        Vec2& coord_parent = parent[coord.y][coord.x];
-        coord_parent = parent[coord_parent.y][coord_parent.x];
-        coord = coord_parent;
+Board::FeatureVector Board::get_feature_scalars(Color to_play) {
+    return DefaultFeatureScalars::get_scalars(*this, to_play);
+}
+
+Board::PackedFeaturePlanes Board::pack_feature_planes(const StackedFeaturePlanes& planes) {
+    PackedFeaturePlanes packed{};
+    const float* data = &planes[0][0][0];
+    for (int i = 0; i < num_feature_plane_bits; ++i) {
+        packed[i / 64] |= static_cast<uint64_t>(data[i] != 0.0f) << (i % 64);
     }
-    return coord;
+    return packed;
 }
 
-void Board::unite(Vec2 a, Vec2 b) {
-    a = find(a);
-    b = find(b);
-    if (a == b) {
-        return;
+void Board::unpack_feature_planes(const PackedFeaturePlanes& packed, StackedFeaturePlanes& planes) {
+    float* data = &planes[0][0][0];
+    for (int i = 0; i < num_feature_plane_bits; ++i) {
+        data[i] = static_cast<float>((packed[i / 64] >> (i % 64)) & 1);
     }
+}
 
-    if (group[a.y][a.x].size() < group[b.y][b.x].size()) {
-        const Vec2 tmp = a;
-        a = b;
-        b = tmp;
+uint64_t Board::get_feature_key(Color to_play) const {
+    // Stones including setup stones, side to move, komi and ruleset.
+    uint64_t key = symmetric_zobrist[0] ^ get_context_hash(to_play);
+    auto combine = [&key](uint64_t value) {
+        uint64_t state = key ^ value;
+        key = splitmix64(state);
+    };
+    // The context hash treats transposed sizes as equal, but the planes of a 9x13 and a 13x9 board
+    // are laid out differently.
+    combine(static_cast<uint64_t>(board_size.x) | static_cast<uint64_t>(board_size.y) << 8);
+
+    // Recent moves are used by the history planes and the pass scalars.
+    static constexpr int num_recent_moves = 5;
+    for (int dist = 0; dist < num_recent_moves && dist < history.size(); ++dist) {
+        const auto& move = history.rbegin()[dist];
+        // The coordinate of a pass is meaningless.
+        const Vec2 coord = move.is_pass ? Vec2{0, 0} : move.coord;
+        combine(static_cast<uint64_t>(move.color) | static_cast<uint64_t>(move.is_pass) << 2 |
+                static_cast<uint64_t>(coord.x) << 3 | static_cast<uint64_t>(coord.y) << 8);
     }
+    combine(static_cast<uint64_t>(first_player_to_pass) |
+            static_cast<uint64_t>(static_cast<uint32_t>(num_captures)) << 2);
+    combine(num_setup_stones + history.size());
 
-    parent[b.y][b.x] = a;
-    group[a.y][a.x].insert(std::end(group[a.y][a.x]), std::begin(group[b.y][b.x]),
-                           std::end(group[b.y][b.x]));
-    liberties[a.y][a.x].insert(liberties[b.y][b.x].begin(), liberties[b.y][b.x].end());
+    // Legality of ko moves depends on the previous board states.
+    for (const uint64_t previous : zobrist_history) {
+        combine(previous);
+    }
+    return key;
 }
 
-bool Board::any_ko_move(Color to_play) {
+Board::State Board::get_state() const {
+    State state;
+    state.stones.reserve(board_size.x * board_size.y);
     for (int y = 0; y < board_size.y; ++y) {
         for (int x = 0; x < board_size.x; ++x) {
-            const auto move_legality = get_move_legality(Move{to_play, false, {x, y}});
-            if (move_legality == MoveLegality::Ko) {
-                return true;
+            state.stones.push_back(static_cast<Color>(board[to_point(x + padding, y + padding)]));
+        }
+    }
+    state.history = history;
+    state.zobrist = zobrist;
+    state.zobrist_history = zobrist_history;
+    state.first_player_to_pass = first_player_to_pass;
+    state.num_captures = num_captures;
+    state.num_setup_stones = num_setup_stones;
+    for (int t = 1; t < num_stone_history; ++t) {
+        state.stone_history.push_back(
+            stone_history[(stone_history_head - t + max_stone_history) % max_stone_history]);
+    }
+    return state;
+}
+
+void Board::set_state(const State& state) {
+    if (state.stones.size() != static_cast<size_t>(board_size.x * board_size.y)) {
+        throw std::runtime_error("Board state does not match the board size");
+    }
+
+    reset();
+    for (int y = 0; y < board_size.y; ++y) {
+        for (int x = 0; x < board_size.x; ++x) {
+            const Color color = state.stones[y * board_size.x + x];
+            if (color == Black || color == White) {
+                setup_move(Move{color, false, {x, y}});
             }
         }
     }
-    return false;
+    history = state.history;
+    zobrist = state.zobrist;
+    zobrist_history = state.zobrist_history;
+    first_player_to_pass = state.first_player_to_pass;
+    num_captures = state.num_captures;
+    num_setup_stones = state.num_setup_stones;
+
+    // The current position was set up above.
+    num_stone_history = 1 + std::min<int>(state.stone_history.size(), max_stone_history - 1);
+    for (int t = 1; t < num_stone_history; ++t) {
+        stone_history[(stone_history_head - t + max_stone_history) % max_stone_history] =
+            state.stone_history[t - 1];
+    }
+}
+
+Board::Point Board::find(Point point) {
+    while (parent[point] != point) {
+        Point& point_parent = parent[point];
+        point_parent = parent[point_parent];
+        point = point_parent;
+    }
+    return point;
+}
+
+void Board::unite(Point a, Point b) {
+    a = find(a);
+    b = find(b);
+    if (a == b) {
+        return;
+    }
+
+    if (group[a].size() < group[b].size()) {
+        std::swap(a, b);
+    }
+
+    parent[b] = a;
+    group[a].insert(std::end(group[a]), std::begin(group[b]), std::end(group[b]));
+    liberties[a].merge(liberties[b]);
 }
 
 }  // namespace go_data_gen
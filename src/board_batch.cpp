@@ -0,0 +1,133 @@
+#include "go_data_gen/board_batch.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "go_data_gen/feature_expand.hpp"
+#include "go_data_gen/parallel.hpp"
+
+namespace go_data_gen {
+
+BoardBatch::BoardBatch(int num_boards, Vec2 board_size, float komi, Ruleset ruleset,
+                       int _num_threads)
+    : boards(num_boards, Board(board_size, komi, ruleset)),
+      to_play_colors(num_boards, Black),
+      num_threads{_num_threads},
+      checked_moves(num_boards, Move{Empty, true, {0, 0}}) {}
+
+void BoardBatch::reset() {
+    parallel_for(boards.size(), num_threads, [this](size_t i) {
+        boards[i].reset();
+        to_play_colors[i] = Black;
+    });
+}
+
+void BoardBatch::reset(int i) {
+    check_index(i);
+    boards[i].reset();
+    to_play_colors[i] = Black;
+}
+
+void BoardBatch::play(const int* moves) {
+    check_moves(moves);
+    parallel_for(boards.size(), num_threads, [this](size_t i) { play_one(static_cast<int>(i)); });
+}
+
+void BoardBatch::get_features(float* feature_planes, float* feature_scalars,
+                              uint8_t* legal_masks) {
+    parallel_for(boards.size(), num_threads, [&](size_t i) {
+        get_features_one(static_cast<int>(i), feature_planes, feature_scalars, legal_masks);
+    });
+}
+
+void BoardBatch::step(const int* moves, float* feature_planes, float* feature_scalars,
+                      uint8_t* legal_masks) {
+    check_moves(moves);
+    parallel_for(boards.size(), num_threads, [&](size_t i) {
+        play_one(static_cast<int>(i));
+        get_features_one(static_cast<int>(i), feature_planes, feature_scalars, legal_masks);
+    });
+}
+
+void BoardBatch::check_index(int i) const {
+    if (i < 0 || i >= size()) {
+        throw std::out_of_range("Board index " + std::to_string(i) +
+                                " is out of range for a batch of " + std::to_string(size()));
+    }
+}
+
+void BoardBatch::check_moves(const int* moves) {
+    parallel_for(boards.size(), num_threads,
+                 [this, moves](size_t i) { check_move(static_cast<int>(i), moves[i]); });
+}
+
+void BoardBatch::check_move(int i, int move) {
+    if (move == no_move) {
+        checked_moves[i] = Move{Empty, true, {0, 0}};
+        return;
+    }
+    const Color color = to_play_colors[i];
+    const Move board_move =
+        move == pass_move
+            ? Move{color, true, {0, 0}}
+            : Move{color, false, {move % Board::max_board_size, move / Board::max_board_size}};
+    if (!board_move.is_pass) {
+        const Vec2 board_size = boards[i].get_board_size();
+        if (move < 0 || board_move.coord.x >= board_size.x || board_move.coord.y >= board_size.y) {
+            throw std::out_of_range("Move " + std::to_string(move) + " is off the board " +
+                                    std::to_string(i));
+        }
+    }
+    if (!boards[i].is_legal(board_move)) {
+        throw std::runtime_error("Illegal move " + std::to_string(move) + " on board " +
+                                 std::to_string(i));
+    }
+    checked_moves[i] = board_move;
+}
+
+void BoardBatch::play_one(int i) {
+    const Move& move = checked_moves[i];
+    if (move.color == Empty) {
+        return;
+    }
+    boards[i].play(move);
+    to_play_colors[i] = opposite(move.color);
+}
+
+void BoardBatch::get_features_one(int i, float* feature_planes, float* feature_scalars,
+                                  uint8_t* legal_masks) {
+    const Color color = to_play_colors[i];
+    const bool needs_rows = feature_planes != nullptr || legal_masks != nullptr;
+    Board::FeaturePlaneRows rows;
+    Board::FeatureVector scalars;
+    // Planes and scalars share the legality pass when computed together.
+    if (needs_rows && feature_scalars != nullptr) {
+        boards[i].get_features(color, rows, scalars);
+    } else if (needs_rows) {
+        rows = boards[i].get_feature_plane_rows(color);
+    } else if (feature_scalars != nullptr) {
+        scalars = boards[i].get_feature_scalars(color);
+    }
+    if (needs_rows) {
+        if (feature_planes != nullptr) {
+            expand_rows_chw(&rows[0][0], Board::data_size, Board::data_size,
+                            Board::num_feature_planes,
+                            feature_planes + static_cast<size_t>(i) * feature_planes_size);
+        }
+        if (legal_masks != nullptr) {
+            uint32_t legal_rows[Board::data_size];
+            for (int y = 0; y < Board::data_size; ++y) {
+                legal_rows[y] = rows[y][Board::legal_move_plane_index];
+            }
+            expand_rows_chw(legal_rows, Board::data_size, Board::data_size, 1,
+                            legal_masks + static_cast<size_t>(i) * legal_mask_size);
+        }
+    }
+    if (feature_scalars != nullptr) {
+        std::memcpy(feature_scalars + static_cast<size_t>(i) * Board::num_feature_scalars,
+                    scalars.data(), sizeof(scalars));
+    }
+}
+
+}  // namespace go_data_gen
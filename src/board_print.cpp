@@ -44,13 +44,13 @@ void Board::print(std::function<bool(int x, int y)> highlight_fn) {
             // Select background color
             if (is_highlighted) {
                 printf("%s", CYAN_BG);
-            } else if (static_cast<Color>(board[mem_y][mem_x]) == OffBoard) {
+            } else if (static_cast<Color>(board[to_point(mem_x, mem_y)]) == OffBoard) {
                 printf("%s", OFFBOARD_BG);
             } else {
                 printf("%s", is_last_move ? HIGHLIGHT_BG : BOARD_BG);
             }
 
-            switch (static_cast<Color>(board[mem_y][mem_x])) {
+            switch (static_cast<Color>(board[to_point(mem_x, mem_y)])) {
             case Empty: {
                 printf("%s", BLACK_FG);
                 if (x == 0 && y == 0)
@@ -96,8 +96,7 @@ void Board::print(std::function<bool(int x, int y)> highlight_fn) {
 void Board::print_group_sizes() {
     for (int y = 0; y < board_size.y; ++y) {
         for (int x = 0; x < board_size.x; ++x) {
-            const auto root = find({x + padding, y + padding});
-            const int size = group[root.y][root.x].size();
+            const int size = group[find(to_point(x + padding, y + padding))].size();
             printf("%2d ", size);
         }
         printf("\n");
@@ -108,8 +107,7 @@ void Board::print_group_sizes() {
 void Board::print_liberties() {
     for (int y = 0; y < board_size.y; ++y) {
         for (int x = 0; x < board_size.x; ++x) {
-            const auto root = find({x + padding, y + padding});
-            const int libs = liberties[root.y][root.x].size();
+            const int libs = liberties[find(to_point(x + padding, y + padding))].size();
             printf("%2d ", libs);
         }
         printf("\n");
@@ -0,0 +1,283 @@
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "go_data_gen/board.hpp"
+#include "go_data_gen/zobrist.hpp"
+
+namespace {
+
+constexpr char board_magic[4] = {'G', 'D', 'G', 'B'};
+constexpr uint8_t board_version = 1;
+
+template <typename T>
+void append_pod(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void append_array(std::string& out, const T* values, size_t size) {
+    out.append(reinterpret_cast<const char*>(values), size * sizeof(T));
+}
+
+class Reader {
+public:
+    explicit Reader(std::string_view _data) : data{_data} {}
+
+    template <typename T>
+    T read() {
+        T value;
+        read_array(&value, 1);
+        return value;
+    }
+
+    template <typename T>
+    void read_array(T* values, size_t size) {
+        if (size > (data.size() - pos) / sizeof(T)) {
+            throw std::runtime_error("Serialized board is truncated");
+        }
+        std::memcpy(values, data.data() + pos, size * sizeof(T));
+        pos += size * sizeof(T);
+    }
+
+    bool at_end() const { return pos == data.size(); }
+    size_t remaining() const { return data.size() - pos; }
+
+private:
+    std::string_view data;
+    size_t pos = 0;
+};
+
+// Whether every group of the row-major `colors` has a liberty, as in any position reached by play.
+bool have_liberties(const go_data_gen::Color* colors, go_data_gen::Vec2 size) {
+    constexpr int max_points =
+        go_data_gen::Board::max_board_size * go_data_gen::Board::max_board_size;
+    const int num_points = size.x * size.y;
+    const auto for_each_neighbor = [&](int i, auto&& func) {
+        const int x = i % size.x;
+        const int y = i / size.x;
+        if (x > 0) func(i - 1);
+        if (x < size.x - 1) func(i + 1);
+        if (y > 0) func(i - size.x);
+        if (y < size.y - 1) func(i + size.x);
+    };
+
+    // Flood fill each group from the stones next to empty points.
+    bool reached[max_points] = {};
+    int stack[max_points];
+    int num_stack = 0;
+    for (int i = 0; i < num_points; ++i) {
+        if (colors[i] != go_data_gen::Empty) {
+            continue;
+        }
+        for_each_neighbor(i, [&](int neighbor) {
+            if (colors[neighbor] != go_data_gen::Empty && !reached[neighbor]) {
+                reached[neighbor] = true;
+                stack[num_stack++] = neighbor;
+            }
+        });
+    }
+    while (num_stack > 0) {
+        const int i = stack[--num_stack];
+        for_each_neighbor(i, [&](int neighbor) {
+            if (colors[neighbor] == colors[i] && !reached[neighbor]) {
+                reached[neighbor] = true;
+                stack[num_stack++] = neighbor;
+            }
+        });
+    }
+    for (int i = 0; i < num_points; ++i) {
+        if (colors[i] != go_data_gen::Empty && !reached[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+namespace go_data_gen {
+
+// Layout, in native byte order:
+//   magic, version, zobrist seed, board size, komi, ruleset, handicap,
+//   first player to pass, captures, setup stones, zobrist hash,
+//   stones (2 bits per point, row-major), history (PackedMove), zobrist history,
+//   previous positions of the stone history (board rows of both colors, most recent first).
+// Groups, liberties and symmetric hashes are rebuilt from the stones.
+std::string Board::serialize() const {
+    std::string out;
+    const int num_points = board_size.x * board_size.y;
+    out.reserve(64 + num_points / 4 + history.size() * sizeof(PackedMove) +
+                zobrist_history.size() * sizeof(uint64_t) +
+                num_stone_history * 2 * board_size.y * sizeof(uint32_t));
+
+    append_array(out, board_magic, sizeof(board_magic));
+    append_pod(out, board_version);
+    append_pod(out, get_zobrist_seed());
+    append_pod(out, static_cast<uint8_t>(board_size.x));
+    append_pod(out, static_cast<uint8_t>(board_size.y));
+    append_pod(out, komi);
+    const uint8_t rules[5] = {static_cast<uint8_t>(ruleset.ko_rule),
+                              static_cast<uint8_t>(ruleset.suicide_rule),
+                              static_cast<uint8_t>(ruleset.scoring_rule),
+                              static_cast<uint8_t>(ruleset.tax_rule),
+                              static_cast<uint8_t>(ruleset.first_player_pass_bonus_rule)};
+    append_array(out, rules, 5);
+    append_pod(out, static_cast<int32_t>(num_handicap_stones));
+    append_pod(out, static_cast<uint8_t>(first_player_to_pass));
+    append_pod(out, static_cast<int32_t>(num_captures));
+    append_pod(out, static_cast<int32_t>(num_setup_stones));
+    append_pod(out, zobrist);
+
+    const size_t stones_offset = out.size();
+    out.resize(out.size() + (num_points + 3) / 4, 0);
+    for (int y = 0; y < board_size.y; ++y) {
+        for (int x = 0; x < board_size.x; ++x) {
+            const int i = y * board_size.x + x;
+            const int color = board[to_point(x + padding, y + padding)];
+            out[stones_offset + i / 4] |= static_cast<char>(color << (i % 4 * 2));
+        }
+    }
+
+    append_pod(out, static_cast<uint32_t>(history.size()));
+    for (const Move& move : history) {
+        append_pod(out, PackedMove::from_move(move));
+    }
+    append_pod(out, static_cast<uint32_t>(zobrist_history.size()));
+    append_array(out, zobrist_history.data(), zobrist_history.size());
+
+    append_pod(out, static_cast<uint8_t>(num_stone_history - 1));
+    for (int t = 1; t < num_stone_history; ++t) {
+        const auto& rows =
+            stone_history[(stone_history_head - t + max_stone_history) % max_stone_history];
+        for (const auto& color_rows : rows) {
+            append_array(out, &color_rows[padding], board_size.y);
+        }
+    }
+    return out;
+}
+
+void Board::deserialize(std::string_view data) {
+    // The board is only replaced once all of the data was read and checked.
+    Board result;
+    Reader reader(data);
+    char magic[sizeof(board_magic)];
+    reader.read_array(magic, sizeof(magic));
+    if (std::memcmp(magic, board_magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not a serialized board");
+    }
+    if (reader.read<uint8_t>() != board_version) {
+        throw std::runtime_error("Unsupported serialized board version");
+    }
+    if (reader.read<uint64_t>() != get_zobrist_seed()) {
+        throw std::runtime_error("Board was serialized with a different zobrist seed");
+    }
+    const int size_x = reader.read<uint8_t>();
+    const int size_y = reader.read<uint8_t>();
+    if (size_x < 1 || size_y < 1 || size_x > max_board_size || size_y > max_board_size) {
+        throw std::runtime_error("Invalid board size in serialized board");
+    }
+    const float serialized_komi = reader.read<float>();
+    uint8_t rules[5];
+    reader.read_array(rules, 5);
+    if (rules[0] > 2 || rules[1] > 1 || rules[2] > 1 || rules[3] > 2 || rules[4] > 1) {
+        throw std::runtime_error("Invalid ruleset in serialized board");
+    }
+    const Ruleset serialized_ruleset{
+        static_cast<KoRule>(rules[0]), static_cast<SuicideRule>(rules[1]),
+        static_cast<ScoringRule>(rules[2]), static_cast<TaxRule>(rules[3]),
+        static_cast<FirstPlayerPassBonusRule>(rules[4])};
+    const int num_points = size_x * size_y;
+    const int serialized_num_handicap_stones = reader.read<int32_t>();
+    if (serialized_num_handicap_stones < 0 || serialized_num_handicap_stones > num_points) {
+        throw std::runtime_error("Invalid number of handicap stones in serialized board");
+    }
+    const auto first_player_to_pass_value = reader.read<uint8_t>();
+    if (first_player_to_pass_value != Empty && first_player_to_pass_value != Black &&
+        first_player_to_pass_value != White) {
+        throw std::runtime_error("Invalid first player to pass in serialized board");
+    }
+    const auto serialized_first_player_to_pass = static_cast<Color>(first_player_to_pass_value);
+    const int serialized_num_captures = reader.read<int32_t>();
+    const int serialized_num_setup_stones = reader.read<int32_t>();
+    if (serialized_num_setup_stones < 0 || serialized_num_setup_stones > num_points) {
+        throw std::runtime_error("Invalid number of setup stones in serialized board");
+    }
+    const auto serialized_zobrist = reader.read<uint64_t>();
+
+    result.reset({size_x, size_y}, serialized_komi, serialized_ruleset,
+                 serialized_num_handicap_stones);
+    uint8_t stones[(max_board_size * max_board_size + 3) / 4];
+    reader.read_array(stones, (num_points + 3) / 4);
+    Color colors[max_board_size * max_board_size];
+    for (int i = 0; i < num_points; ++i) {
+        colors[i] = static_cast<Color>((stones[i / 4] >> (i % 4 * 2)) & 3);
+        if (colors[i] == OffBoard) {
+            throw std::runtime_error("Invalid stone in serialized board");
+        }
+    }
+    if (!have_liberties(colors, {size_x, size_y})) {
+        throw std::runtime_error("Group without liberties in serialized board");
+    }
+    for (int i = 0; i < num_points; ++i) {
+        if (colors[i] == Black || colors[i] == White) {
+            result.setup_move(Move{colors[i], false, {i % size_x, i / size_x}});
+        }
+    }
+
+    const auto num_moves = reader.read<uint32_t>();
+    if (num_moves > reader.remaining() / sizeof(PackedMove)) {
+        throw std::runtime_error("Serialized board is truncated");
+    }
+    for (uint32_t i = 0; i < num_moves; ++i) {
+        const auto move = reader.read<PackedMove>();
+        if ((move.color != Black && move.color != White) ||
+            (!move.is_pass &&
+             (move.x < 0 || move.x >= size_x || move.y < 0 || move.y >= size_y))) {
+            throw std::runtime_error("Invalid move in serialized board");
+        }
+        result.history.push_back(move.to_move());
+    }
+    // Captured stones were on the board when play began or were played since.
+    if (std::abs(static_cast<int64_t>(serialized_num_captures)) >
+        static_cast<int64_t>(num_points) + num_moves) {
+        throw std::runtime_error("Invalid number of captures in serialized board");
+    }
+    const auto num_hashes = reader.read<uint32_t>();
+    if (num_hashes > reader.remaining() / sizeof(uint64_t)) {
+        throw std::runtime_error("Serialized board is truncated");
+    }
+    result.zobrist_history.resize(num_hashes);
+    reader.read_array(result.zobrist_history.data(), num_hashes);
+    result.zobrist = serialized_zobrist;
+    result.first_player_to_pass = serialized_first_player_to_pass;
+    result.num_captures = serialized_num_captures;
+    result.num_setup_stones = serialized_num_setup_stones;
+
+    const int num_previous = reader.read<uint8_t>();
+    if (num_previous >= max_stone_history) {
+        throw std::runtime_error("Invalid stone history in serialized board");
+    }
+    // Bits outside of the board would show up as stones in the history planes.
+    const uint32_t row_mask = ((1u << size_x) - 1) << padding;
+    result.num_stone_history = 1 + num_previous;
+    for (int t = 1; t < result.num_stone_history; ++t) {
+        auto& rows = result.stone_history[(result.stone_history_head - t + max_stone_history) %
+                                          max_stone_history];
+        rows = StoneRows{};
+        for (auto& color_rows : rows) {
+            reader.read_array(&color_rows[padding], size_y);
+            for (int y = padding; y < padding + size_y; ++y) {
+                if ((color_rows[y] & ~row_mask) != 0) {
+                    throw std::runtime_error("Invalid stone history in serialized board");
+                }
+            }
+        }
+    }
+    if (!reader.at_end()) {
+        throw std::runtime_error("Unexpected trailing data in serialized board");
+    }
+    *this = std::move(result);
+}
+
+}  // namespace go_data_gen
@@ -0,0 +1,88 @@
+#include "go_data_gen/bucketed_batcher.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "go_data_gen/feature_expand.hpp"
+
+namespace go_data_gen {
+
+BucketedBatcher::BucketedBatcher(int _batch_size) : batch_size{_batch_size} {
+    if (batch_size < 1) {
+        throw std::runtime_error("Batch size must be >= 1");
+    }
+}
+
+void BucketedBatcher::add(Board& board, Color to_play, const Move& move, float result) {
+    Board::FeaturePlaneRows rows;
+    Board::FeatureVector scalars;
+    board.get_features(to_play, rows, scalars);
+    add(board.get_board_size(), rows, scalars, move, result);
+}
+
+void BucketedBatcher::add(Vec2 board_size, const Board::FeaturePlaneRows& rows,
+                          const Board::FeatureVector& scalars, const Move& move, float result) {
+    Batch& batch = buckets[{board_size.x, board_size.y}];
+    if (batch.size == 0) {
+        batch.board_size = board_size;
+        batch.height = board_size.y + 2 * Board::padding;
+        batch.width = board_size.x + 2 * Board::padding;
+        const int area = batch.height * batch.width;
+        batch.feature_planes.resize(batch_size * Board::num_feature_planes * area);
+        batch.feature_scalars.resize(batch_size * Board::num_feature_scalars);
+        batch.masks.resize(batch_size * area);
+        batch.moves.resize(batch_size);
+        batch.results.resize(batch_size);
+    }
+
+    // The board starts at the top-left corner of the rows, so cropping only means expanding the
+    // first `height` rows and the low `width` bits.
+    const int i = batch.size;
+    const int area = batch.height * batch.width;
+    expand_rows_chw(&rows[0][0], batch.height, batch.width, Board::num_feature_planes,
+                    &batch.feature_planes[i * Board::num_feature_planes * area]);
+    uint32_t mask_rows[Board::data_size];
+    for (int y = 0; y < batch.height; ++y) {
+        mask_rows[y] = rows[y][Board::on_board_plane_index];
+    }
+    expand_rows_chw(mask_rows, batch.height, batch.width, 1, &batch.masks[i * area]);
+    std::copy(scalars.begin(), scalars.end(),
+              batch.feature_scalars.begin() + i * Board::num_feature_scalars);
+    batch.moves[i] = move.is_pass ? -1
+                                  : (move.coord.y + Board::padding) * batch.width + move.coord.x +
+                                        Board::padding;
+    batch.results[i] = result;
+
+    if (++batch.size == batch_size) {
+        ready.push_back(std::move(batch));
+        batch = Batch{};
+    }
+}
+
+void BucketedBatcher::flush() {
+    for (auto& [size, batch] : buckets) {
+        if (batch.size == 0) {
+            continue;
+        }
+        // Trim the arrays to the number of positions.
+        const int area = batch.height * batch.width;
+        batch.feature_planes.resize(batch.size * Board::num_feature_planes * area);
+        batch.feature_scalars.resize(batch.size * Board::num_feature_scalars);
+        batch.masks.resize(batch.size * area);
+        batch.moves.resize(batch.size);
+        batch.results.resize(batch.size);
+        ready.push_back(std::move(batch));
+        batch = Batch{};
+    }
+}
+
+bool BucketedBatcher::pop(Batch& batch) {
+    if (ready.empty()) {
+        return false;
+    }
+    batch = std::move(ready.front());
+    ready.pop_front();
+    return true;
+}
+
+}  // namespace go_data_gen
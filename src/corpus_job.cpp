@@ -0,0 +1,225 @@
+#include "go_data_gen/corpus_job.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "go_data_gen/incremental_featurizer.hpp"
+#include "go_data_gen/parallel.hpp"
+#include "go_data_gen/sgf.hpp"
+
+namespace {
+
+// Makes the data written to `path` durable, so that a checkpoint that refers to it survives a
+// crash of the host, not only of the process.
+void sync_file(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    const bool synced = fd >= 0 && ::fsync(fd) == 0;
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (!synced) {
+        throw std::runtime_error("Could not sync the file: " + path);
+    }
+}
+
+}  // namespace
+
+namespace go_data_gen {
+
+uint64_t stable_hash(std::string_view data) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char c : data) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+int get_shard_index(std::string_view input, int num_shards) {
+    return static_cast<int>(stable_hash(input) % static_cast<uint64_t>(num_shards));
+}
+
+void featurize_sgf(const std::string& path, std::string& output) {
+    // CorpusJob runs each shard on its own thread, so this is one loader per shard. Games that do
+    // not load with status Ok are skipped, which is as deterministic as converting them.
+    thread_local GameLoader loader;
+    if (loader.load(path) != SgfStatus::Ok) {
+        return;
+    }
+
+    const std::vector<Move>& moves = loader.get_moves();
+    IncrementalFeaturizer featurizer(loader.get_board(), moves.front().color);
+    PositionRecord record{};
+    record.result = loader.get_result();
+    for (const Move& move : moves) {
+        record.planes = Board::pack_feature_planes(featurizer.get_feature_planes());
+        record.scalars = featurizer.get_feature_scalars();
+        record.move = static_cast<int16_t>(
+            move.is_pass ? -1 : move.coord.y * Board::max_board_size + move.coord.x);
+        record.to_play = static_cast<int8_t>(move.color);
+        output.append(reinterpret_cast<const char*>(&record), sizeof(record));
+        featurizer.play(move);
+    }
+}
+
+CorpusJob::CorpusJob(const std::vector<std::string>& inputs, const std::string& _input_root,
+                     const std::string& _output_dir, int num_shards, int _checkpoint_interval)
+    : input_root{_input_root}, output_dir{_output_dir}, checkpoint_interval{_checkpoint_interval} {
+    if (num_shards < 1 || checkpoint_interval < 1) {
+        throw std::runtime_error("The number of shards and the checkpoint interval must be >= 1");
+    }
+
+    shard_inputs.resize(num_shards);
+    for (const auto& input : inputs) {
+        shard_inputs[get_shard_index(input, num_shards)].push_back(input);
+    }
+    // The order of the input list must not matter.
+    for (auto& shard : shard_inputs) {
+        std::sort(shard.begin(), shard.end());
+        shard.erase(std::unique(shard.begin(), shard.end()), shard.end());
+    }
+    std::filesystem::create_directories(output_dir);
+}
+
+std::string CorpusJob::get_shard_path(int shard) const {
+    char name[64];
+    std::snprintf(name, sizeof(name), "shard-%05d-of-%05d.bin", shard, num_shards());
+    return (std::filesystem::path(output_dir) / name).string();
+}
+
+std::string CorpusJob::get_progress_path(int shard) const {
+    std::string path = get_shard_path(shard);
+    path.replace(path.size() - 4, 4, ".progress");
+    return path;
+}
+
+bool CorpusJob::is_shard_complete(int shard) const {
+    const Progress progress = read_progress(shard);
+    return progress.complete && progress.fingerprint == get_fingerprint(shard) &&
+           std::filesystem::exists(get_shard_path(shard));
+}
+
+void CorpusJob::run(const std::vector<int>& shards, const ConvertFn& convert, int num_threads) {
+    for (const int shard : shards) {
+        if (shard < 0 || shard >= num_shards()) {
+            throw std::runtime_error("Shard index out of range: " + std::to_string(shard));
+        }
+    }
+    parallel_for(shards.size(), num_threads, [&](size_t i) { run_shard(shards[i], convert); });
+}
+
+uint64_t CorpusJob::get_fingerprint(int shard) const {
+    // Identifies the shard's inputs and the record format, so that progress of a different job or
+    // of a binary with other records is never resumed.
+    std::string key = std::to_string(num_shards()) + '\n';
+    key += "records " + std::to_string(position_record_version) + ' ' +
+           std::to_string(sizeof(PositionRecord)) + '\n';
+    for (const auto& input : shard_inputs[shard]) {
+        key += input;
+        key += '\n';
+    }
+    return stable_hash(key);
+}
+
+CorpusJob::Progress CorpusJob::read_progress(int shard) const {
+    Progress progress;
+    std::ifstream in(get_progress_path(shard));
+    std::string key;
+    while (in >> key) {
+        if (key == "fingerprint") {
+            in >> std::hex >> progress.fingerprint >> std::dec;
+        } else if (key == "inputs_done") {
+            in >> progress.num_inputs_done;
+        } else if (key == "bytes") {
+            in >> progress.num_bytes;
+        } else if (key == "complete") {
+            in >> progress.complete;
+        }
+    }
+    return progress;
+}
+
+void CorpusJob::write_progress(int shard, const Progress& progress) const {
+    // Written to a temporary file and renamed, so a crash never leaves a torn progress file.
+    const std::string path = get_progress_path(shard);
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::trunc);
+        out << "fingerprint " << std::hex << progress.fingerprint << std::dec << '\n'
+            << "inputs_done " << progress.num_inputs_done << '\n'
+            << "bytes " << progress.num_bytes << '\n'
+            << "complete " << progress.complete << '\n';
+        if (!out) {
+            throw std::runtime_error("Could not write the file: " + tmp_path);
+        }
+    }
+    sync_file(tmp_path);
+    std::filesystem::rename(tmp_path, path);
+}
+
+void CorpusJob::run_shard(int shard, const ConvertFn& convert) {
+    const std::string path = get_shard_path(shard);
+    const std::string partial_path = path + ".partial";
+    const auto& inputs = shard_inputs[shard];
+    const uint64_t fingerprint = get_fingerprint(shard);
+
+    Progress progress = read_progress(shard);
+    if (progress.fingerprint != 0 && progress.fingerprint != fingerprint) {
+        throw std::runtime_error("Inputs or record format changed since the shard was started: " +
+                                 path);
+    }
+    if (progress.complete && std::filesystem::exists(path)) {
+        return;
+    }
+    // Continue from the last checkpoint, dropping any output written after it. Start over if the
+    // checkpointed output is gone.
+    if (progress.complete || !std::filesystem::exists(partial_path) ||
+        std::filesystem::file_size(partial_path) < progress.num_bytes) {
+        progress = Progress{};
+        std::ofstream{partial_path, std::ios::binary | std::ios::trunc};
+    }
+    progress.fingerprint = fingerprint;
+    std::filesystem::resize_file(partial_path, progress.num_bytes);
+
+    std::ofstream out(partial_path, std::ios::binary | std::ios::app);
+    if (!out.is_open()) {
+        throw std::runtime_error("Could not open the file: " + partial_path);
+    }
+    std::string output;
+    for (size_t i = progress.num_inputs_done; i < inputs.size(); ++i) {
+        output.clear();
+        convert(input_root.empty() ? inputs[i]
+                                   : (std::filesystem::path(input_root) / inputs[i]).string(),
+                output);
+        out.write(output.data(), output.size());
+        progress.num_inputs_done = i + 1;
+        progress.num_bytes += output.size();
+
+        if (progress.num_inputs_done % checkpoint_interval == 0) {
+            // The output must reach the disk before the progress that refers to it.
+            out.flush();
+            if (!out) {
+                throw std::runtime_error("Could not write the file: " + partial_path);
+            }
+            sync_file(partial_path);
+            write_progress(shard, progress);
+        }
+    }
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Could not write the file: " + partial_path);
+    }
+    sync_file(partial_path);
+
+    std::filesystem::rename(partial_path, path);
+    progress.complete = true;
+    write_progress(shard, progress);
+}
+
+}  // namespace go_data_gen
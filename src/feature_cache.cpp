@@ -0,0 +1,92 @@
+#include "go_data_gen/feature_cache.hpp"
+
+#include <algorithm>
+
+#include "go_data_gen/feature_expand.hpp"
+
+namespace go_data_gen {
+
+FeatureCache::FeatureCache(size_t capacity)
+    : capacity_per_shard{std::max<size_t>(1, capacity / num_shards)} {}
+
+void FeatureCache::get_features(Board& board, Color to_play, Board::StackedFeaturePlanes& planes,
+                                Board::FeatureVector& scalars) {
+    const uint64_t key = board.get_feature_key(to_play);
+    if (lookup(key, planes, scalars)) {
+        return;
+    }
+    Board::FeaturePlaneRows rows;
+    board.get_features(to_play, rows, scalars);
+    expand_rows_hwc(&rows[0][0], Board::data_size, Board::data_size, Board::num_feature_planes,
+                    &planes[0][0][0]);
+    insert(key, planes, scalars);
+}
+
+bool FeatureCache::lookup(uint64_t key, Board::StackedFeaturePlanes& planes,
+                          Board::FeatureVector& scalars) {
+    Shard& shard = shards[shard_index(key)];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+            Board::unpack_feature_planes(it->second->planes, planes);
+            scalars = it->second->scalars;
+            num_hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    num_misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void FeatureCache::insert(uint64_t key, const Board::StackedFeaturePlanes& planes,
+                          const Board::FeatureVector& scalars) {
+    // Pack outside of the lock.
+    const auto packed = Board::pack_feature_planes(planes);
+
+    Shard& shard = shards[shard_index(key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        // Another thread inserted the same position in the meantime.
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return;
+    }
+
+    if (shard.entries.size() >= capacity_per_shard) {
+        // Reuse the least recently used entry.
+        shard.index.erase(shard.entries.back().key);
+        shard.entries.splice(shard.entries.begin(), shard.entries, std::prev(shard.entries.end()));
+        shard.entries.front() = Entry{key, packed, scalars};
+    } else {
+        shard.entries.push_front(Entry{key, packed, scalars});
+    }
+    shard.index.emplace(key, shard.entries.begin());
+}
+
+double FeatureCache::hit_rate() const {
+    const uint64_t num_lookups = hits() + misses();
+    return num_lookups > 0 ? static_cast<double>(hits()) / num_lookups : 0.0;
+}
+
+size_t FeatureCache::size() const {
+    size_t result = 0;
+    for (const Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        result += shard.entries.size();
+    }
+    return result;
+}
+
+void FeatureCache::clear() {
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.clear();
+        shard.index.clear();
+    }
+    num_hits.store(0, std::memory_order_relaxed);
+    num_misses.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace go_data_gen
@@ -0,0 +1,232 @@
+#include "go_data_gen/feature_expand.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GDG_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using go_data_gen::SimdLevel;
+
+// Bytes of 0/1 for each possible byte of bits, for the uint8 output.
+constexpr std::array<std::array<uint8_t, 8>, 256> make_byte_expansion_table() {
+    std::array<std::array<uint8_t, 8>, 256> table{};
+    for (int bits = 0; bits < 256; ++bits) {
+        for (int i = 0; i < 8; ++i) {
+            table[bits][i] = static_cast<uint8_t>((bits >> i) & 1);
+        }
+    }
+    return table;
+}
+constexpr auto byte_expansion_table = make_byte_expansion_table();
+
+SimdLevel detect_simd_level() {
+#ifdef GDG_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdLevel::SSE2;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+std::atomic<SimdLevel>& current_simd_level() {
+    static std::atomic<SimdLevel> level{go_data_gen::get_supported_simd_level()};
+    return level;
+}
+
+void expand_rows_hwc_scalar(const uint32_t* rows, int height, int width, int num_planes,
+                            float* out) {
+    for (int y = 0; y < height; ++y) {
+        const uint32_t* row = rows + y * num_planes;
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < num_planes; ++c) {
+                *out++ = static_cast<float>((row[c] >> x) & 1);
+            }
+        }
+    }
+}
+
+void expand_rows_chw_scalar(const uint32_t* rows, int height, int width, int num_planes,
+                            float* out) {
+    for (int c = 0; c < num_planes; ++c) {
+        for (int y = 0; y < height; ++y) {
+            const uint32_t bits = rows[y * num_planes + c];
+            for (int x = 0; x < width; ++x) {
+                *out++ = static_cast<float>((bits >> x) & 1);
+            }
+        }
+    }
+}
+
+#ifdef GDG_X86_SIMD
+
+// For each cell, shifts the rows of all planes by x at once and converts the low bits to floats.
+__attribute__((target("sse2"))) void expand_rows_hwc_sse2(const uint32_t* rows, int height,
+                                                          int width, int num_planes, float* out) {
+    const __m128i one = _mm_set1_epi32(1);
+    for (int y = 0; y < height; ++y) {
+        const uint32_t* row = rows + y * num_planes;
+        for (int x = 0; x < width; ++x) {
+            const __m128i shift = _mm_cvtsi32_si128(x);
+            int c = 0;
+            for (; c + 4 <= num_planes; c += 4) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + c));
+                v = _mm_and_si128(_mm_srl_epi32(v, shift), one);
+                _mm_storeu_ps(out + c, _mm_cvtepi32_ps(v));
+            }
+            for (; c < num_planes; ++c) {
+                out[c] = static_cast<float>((row[c] >> x) & 1);
+            }
+            out += num_planes;
+        }
+    }
+}
+
+__attribute__((target("avx2"))) void expand_rows_hwc_avx2(const uint32_t* rows, int height,
+                                                          int width, int num_planes, float* out) {
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i lane_index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    // Lanes of the last, partial group of planes.
+    const __m256i tail_mask =
+        _mm256_cmpgt_epi32(_mm256_set1_epi32(num_planes % 8), lane_index);
+    for (int y = 0; y < height; ++y) {
+        const int* row = reinterpret_cast<const int*>(rows + y * num_planes);
+        for (int x = 0; x < width; ++x) {
+            const __m128i shift = _mm_cvtsi32_si128(x);
+            int c = 0;
+            for (; c + 8 <= num_planes; c += 8) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + c));
+                v = _mm256_and_si256(_mm256_srl_epi32(v, shift), one);
+                _mm256_storeu_ps(out + c, _mm256_cvtepi32_ps(v));
+            }
+            if (c < num_planes) {
+                __m256i v = _mm256_maskload_epi32(row + c, tail_mask);
+                v = _mm256_and_si256(_mm256_srl_epi32(v, shift), one);
+                _mm256_maskstore_ps(out + c, tail_mask, _mm256_cvtepi32_ps(v));
+            }
+            out += num_planes;
+        }
+    }
+}
+
+// For each row, broadcasts the bits and compares them against one bit per lane.
+__attribute__((target("sse2"))) void expand_rows_chw_sse2(const uint32_t* rows, int height,
+                                                          int width, int num_planes, float* out) {
+    const __m128i lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (int c = 0; c < num_planes; ++c) {
+        for (int y = 0; y < height; ++y) {
+            const uint32_t bits = rows[y * num_planes + c];
+            int x = 0;
+            for (; x + 4 <= width; x += 4) {
+                const __m128i v = _mm_set1_epi32(static_cast<int>(bits >> x));
+                const __m128i set = _mm_cmpeq_epi32(_mm_and_si128(v, lane_bits), lane_bits);
+                _mm_storeu_ps(out + x, _mm_and_ps(_mm_castsi128_ps(set), one));
+            }
+            for (; x < width; ++x) {
+                out[x] = static_cast<float>((bits >> x) & 1);
+            }
+            out += width;
+        }
+    }
+}
+
+__attribute__((target("avx2"))) void expand_rows_chw_avx2(const uint32_t* rows, int height,
+                                                          int width, int num_planes, float* out) {
+    const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i lane_index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i tail_mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(width % 8), lane_index);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    for (int c = 0; c < num_planes; ++c) {
+        for (int y = 0; y < height; ++y) {
+            const uint32_t bits = rows[y * num_planes + c];
+            int x = 0;
+            for (; x + 8 <= width; x += 8) {
+                const __m256i v = _mm256_set1_epi32(static_cast<int>(bits >> x));
+                const __m256i set = _mm256_cmpeq_epi32(_mm256_and_si256(v, lane_bits), lane_bits);
+                _mm256_storeu_ps(out + x, _mm256_and_ps(_mm256_castsi256_ps(set), one));
+            }
+            if (x < width) {
+                const __m256i v = _mm256_set1_epi32(static_cast<int>(bits >> x));
+                const __m256i set = _mm256_cmpeq_epi32(_mm256_and_si256(v, lane_bits), lane_bits);
+                _mm256_maskstore_ps(out + x, tail_mask,
+                                    _mm256_and_ps(_mm256_castsi256_ps(set), one));
+            }
+            out += width;
+        }
+    }
+}
+
+#endif  // GDG_X86_SIMD
+
+}  // namespace
+
+namespace go_data_gen {
+
+SimdLevel get_supported_simd_level() {
+    static const SimdLevel supported = detect_simd_level();
+    return supported;
+}
+
+SimdLevel get_simd_level() { return current_simd_level().load(std::memory_order_relaxed); }
+
+void set_simd_level(SimdLevel level) {
+    current_simd_level().store(std::min(level, get_supported_simd_level()),
+                               std::memory_order_relaxed);
+}
+
+void expand_rows_hwc(const uint32_t* rows, int height, int width, int num_planes, float* out) {
+    switch (get_simd_level()) {
+#ifdef GDG_X86_SIMD
+    case SimdLevel::AVX2:
+        expand_rows_hwc_avx2(rows, height, width, num_planes, out);
+        return;
+    case SimdLevel::SSE2:
+        expand_rows_hwc_sse2(rows, height, width, num_planes, out);
+        return;
+#endif
+    default:
+        expand_rows_hwc_scalar(rows, height, width, num_planes, out);
+    }
+}
+
+void expand_rows_chw(const uint32_t* rows, int height, int width, int num_planes, float* out) {
+    switch (get_simd_level()) {
+#ifdef GDG_X86_SIMD
+    case SimdLevel::AVX2:
+        expand_rows_chw_avx2(rows, height, width, num_planes, out);
+        return;
+    case SimdLevel::SSE2:
+        expand_rows_chw_sse2(rows, height, width, num_planes, out);
+        return;
+#endif
+    default:
+        expand_rows_chw_scalar(rows, height, width, num_planes, out);
+    }
+}
+
+void expand_rows_chw(const uint32_t* rows, int height, int width, int num_planes, uint8_t* out) {
+    // Eight cells at a time via a lookup table.
+    for (int c = 0; c < num_planes; ++c) {
+        for (int y = 0; y < height; ++y) {
+            const uint32_t bits = rows[y * num_planes + c];
+            for (int x = 0; x < width; x += 8) {
+                std::memcpy(out + x, byte_expansion_table[(bits >> x) & 0xff].data(),
+                            std::min(8, width - x));
+            }
+            out += width;
+        }
+    }
+}
+
+}  // namespace go_data_gen
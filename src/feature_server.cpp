@@ -0,0 +1,331 @@
+#include "go_data_gen/feature_server.hpp"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+using go_data_gen::max_feature_message_size;
+
+template <typename T>
+void append_pod(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+class Reader {
+public:
+    explicit Reader(std::string_view _data) : data{_data} {}
+
+    template <typename T>
+    T read() {
+        if (data.size() - pos < sizeof(T)) {
+            throw std::runtime_error("Request is truncated");
+        }
+        T value;
+        std::memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    std::string_view rest() const { return data.substr(pos); }
+
+    void expect_end() const {
+        if (pos != data.size()) {
+            throw std::runtime_error("Unexpected data at the end of the request");
+        }
+    }
+
+private:
+    std::string_view data;
+    size_t pos = 0;
+};
+
+// Reads exactly `size` bytes. Returns false if the input ends before the first one.
+bool read_exact(int fd, char* data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t n = ::read(fd, data + done, size - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Could not read message: ") +
+                                     std::strerror(errno));
+        }
+        if (n == 0) {
+            if (done == 0) {
+                return false;
+            }
+            throw std::runtime_error("Connection closed in the middle of a message");
+        }
+        done += n;
+    }
+    return true;
+}
+
+// Reads one frame into `payload`. Returns false at the end of the input.
+bool read_frame(int fd, std::string& payload) {
+    uint32_t size;
+    if (!read_exact(fd, reinterpret_cast<char*>(&size), sizeof(size))) {
+        return false;
+    }
+    if (size > max_feature_message_size) {
+        throw std::runtime_error("Message too large: " + std::to_string(size) + " bytes");
+    }
+    payload.resize(size);
+    if (!read_exact(fd, payload.data(), size)) {
+        throw std::runtime_error("Connection closed in the middle of a message");
+    }
+    return true;
+}
+
+// Writes the size and the payload with a single system call in the common case.
+void write_frame(int fd, std::string_view payload) {
+    const uint32_t size = payload.size();
+    iovec parts[2] = {{const_cast<uint32_t*>(&size), sizeof(size)},
+                      {const_cast<char*>(payload.data()), payload.size()}};
+    iovec* part = parts;
+    int num_parts = 2;
+    while (num_parts > 0) {
+        ssize_t n = ::writev(fd, part, num_parts);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Could not write message: ") +
+                                     std::strerror(errno));
+        }
+        // Skip what was written, in case of a partial write.
+        while (num_parts > 0 && static_cast<size_t>(n) >= part->iov_len) {
+            n -= part->iov_len;
+            ++part;
+            --num_parts;
+        }
+        if (num_parts > 0) {
+            part->iov_base = static_cast<char*>(part->iov_base) + n;
+            part->iov_len -= n;
+        }
+    }
+}
+
+sockaddr_un make_address(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+}  // namespace
+
+namespace go_data_gen {
+
+void FeatureServer::handle(std::string_view request, std::string& response) {
+    response.clear();
+    response.push_back(static_cast<char>(FeatureStatus::Ok));
+    try {
+        Reader reader(request);
+        const auto type = static_cast<FeatureRequest>(reader.read<uint8_t>());
+        const auto session_id = reader.read<uint32_t>();
+
+        if (type == FeatureRequest::NewGame) {
+            // The board comes from any client of the socket, so it is fully checked before a
+            // session exists. Invalid boards throw.
+            Board board;
+            board.deserialize(reader.rest());
+            const uint32_t id = next_session_id++;
+            sessions.emplace(id, std::move(board));
+            append_pod(response, id);
+            return;
+        }
+
+        const auto it = sessions.find(session_id);
+        if (it == sessions.end()) {
+            throw std::runtime_error("Unknown session: " + std::to_string(session_id));
+        }
+        Board& board = it->second;
+        switch (type) {
+            case FeatureRequest::Play: {
+                const auto num_moves = reader.read<uint32_t>();
+                const std::string_view moves = reader.rest();
+                if (moves.size() != static_cast<size_t>(num_moves) * sizeof(PackedMove)) {
+                    throw std::runtime_error("Wrong size of the moves");
+                }
+                // PackedMove only has byte members, so the request can be used in place.
+                board.play_moves(reinterpret_cast<const PackedMove*>(moves.data()), num_moves);
+                break;
+            }
+            case FeatureRequest::GetFeatures: {
+                const auto to_play = static_cast<Color>(reader.read<uint8_t>());
+                reader.expect_end();
+                if (to_play != Black && to_play != White) {
+                    throw std::runtime_error("Invalid color to play");
+                }
+                Board::FeaturePlaneRows rows;
+                Board::FeatureVector scalars;
+                board.get_features(to_play, rows, scalars);
+                append_pod(response, rows);
+                append_pod(response, scalars);
+                break;
+            }
+            case FeatureRequest::CloseGame:
+                reader.expect_end();
+                sessions.erase(it);
+                break;
+            default:
+                throw std::runtime_error("Unknown request type: " +
+                                         std::to_string(static_cast<int>(type)));
+        }
+    } catch (const std::exception& e) {
+        response.clear();
+        response.push_back(static_cast<char>(FeatureStatus::Error));
+        response.append(e.what());
+    }
+}
+
+void FeatureServer::serve(int in_fd, int out_fd) {
+    std::string request;
+    std::string response;
+    while (read_frame(in_fd, request)) {
+        handle(request, response);
+        write_frame(out_fd, response);
+    }
+}
+
+void serve_feature_socket(const std::string& path) {
+    const sockaddr_un address = make_address(path);
+    const int listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        throw std::runtime_error(std::string("Could not create socket: ") + std::strerror(errno));
+    }
+    // Replace a socket left over by a previous server, but nothing else.
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        ::unlink(path.c_str());
+    }
+    if (::bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listen_fd, SOMAXCONN) != 0) {
+        const int error = errno;
+        ::close(listen_fd);
+        throw std::runtime_error("Could not listen on " + path + ": " + std::strerror(error));
+    }
+
+    while (true) {
+        const int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            const int error = errno;
+            ::close(listen_fd);
+            throw std::runtime_error(std::string("Could not accept connection: ") +
+                                     std::strerror(error));
+        }
+        std::thread([fd] {
+            try {
+                FeatureServer server;
+                server.serve(fd, fd);
+            } catch (const std::exception& e) {
+                fprintf(stderr, "Feature server connection failed: %s\n", e.what());
+            }
+            ::close(fd);
+        }).detach();
+    }
+}
+
+FeatureClient::FeatureClient(const std::string& socket_path) : owns_fds{true} {
+    const sockaddr_un address = make_address(socket_path);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Could not create socket: ") + std::strerror(errno));
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Could not connect to " + socket_path + ": " +
+                                 std::strerror(error));
+    }
+    in_fd = fd;
+    out_fd = fd;
+}
+
+FeatureClient::FeatureClient(int _in_fd, int _out_fd)
+    : in_fd{_in_fd}, out_fd{_out_fd}, owns_fds{false} {}
+
+FeatureClient::~FeatureClient() {
+    if (owns_fds) {
+        ::close(in_fd);
+    }
+}
+
+uint32_t FeatureClient::new_game(const Board& board) { return new_game(board.serialize()); }
+
+uint32_t FeatureClient::new_game(std::string_view serialized_board) {
+    begin_request(FeatureRequest::NewGame, 0);
+    request += serialized_board;
+    const std::string_view payload = call();
+    uint32_t session_id;
+    if (payload.size() != sizeof(session_id)) {
+        throw std::runtime_error("Invalid response size");
+    }
+    std::memcpy(&session_id, payload.data(), sizeof(session_id));
+    return session_id;
+}
+
+void FeatureClient::play(uint32_t session_id, const PackedMove* moves, size_t num_moves) {
+    begin_request(FeatureRequest::Play, session_id);
+    append_pod(request, static_cast<uint32_t>(num_moves));
+    request.append(reinterpret_cast<const char*>(moves), num_moves * sizeof(PackedMove));
+    call();
+}
+
+void FeatureClient::get_features(uint32_t session_id, Color to_play,
+                                 Board::FeaturePlaneRows& rows, Board::FeatureVector& scalars) {
+    begin_request(FeatureRequest::GetFeatures, session_id);
+    append_pod(request, static_cast<uint8_t>(to_play));
+    const std::string_view payload = call();
+    if (payload.size() != sizeof(rows) + sizeof(scalars)) {
+        throw std::runtime_error("Invalid response size");
+    }
+    std::memcpy(&rows, payload.data(), sizeof(rows));
+    std::memcpy(&scalars, payload.data() + sizeof(rows), sizeof(scalars));
+}
+
+void FeatureClient::close_game(uint32_t session_id) {
+    begin_request(FeatureRequest::CloseGame, session_id);
+    call();
+}
+
+void FeatureClient::begin_request(FeatureRequest type, uint32_t session_id) {
+    request.clear();
+    append_pod(request, static_cast<uint8_t>(type));
+    append_pod(request, session_id);
+}
+
+std::string_view FeatureClient::call() {
+    write_frame(out_fd, request);
+    if (!read_frame(in_fd, response)) {
+        throw std::runtime_error("Feature server closed the connection");
+    }
+    if (response.empty()) {
+        throw std::runtime_error("Empty response");
+    }
+    const std::string_view payload = std::string_view(response).substr(1);
+    if (static_cast<FeatureStatus>(response[0]) != FeatureStatus::Ok) {
+        throw std::runtime_error("Feature server error: " + std::string(payload));
+    }
+    return payload;
+}
+
+}  // namespace go_data_gen
@@ -0,0 +1,122 @@
+#include "go_data_gen/feature_set.hpp"
+
+#include <algorithm>
+
+namespace go_data_gen {
+
+namespace {
+
+constexpr float points_normalization_factor = 1.0f / 15.0f;
+
+}  // namespace
+
+void LegalMovePlane::compute(const FeatureContext& context, FeatureOutput out) {
+    for (int y = 0; y < Board::data_size; ++y) {
+        out.row(y, 0) = context.moves.legal[y];
+    }
+}
+
+void OnBoardPlane::compute(const FeatureContext& context, FeatureOutput out) {
+    const Vec2 size = context.board.get_board_size();
+    const uint32_t row = ((1u << size.x) - 1) << Board::padding;
+    for (int y = Board::padding; y < size.y + Board::padding; ++y) {
+        out.row(y, 0) = row;
+    }
+}
+
+void StonePlanes::compute(const FeatureContext& context, FeatureOutput out) {
+    const auto& stones = stone_rows(context.board);
+    const int own = context.to_play - Black;
+    for (int y = 0; y < Board::data_size; ++y) {
+        out.row(y, 0) = stones[own][y];
+        out.row(y, 1) = stones[1 - own][y];
+    }
+}
+
+void KoPlane::compute(const FeatureContext& context, FeatureOutput out) {
+    for (int y = 0; y < Board::data_size; ++y) {
+        out.row(y, 0) = context.moves.ko[y];
+    }
+}
+
+void LibertyPlanes::compute(const FeatureContext& context, FeatureOutput out) {
+    const auto& stones = stone_rows(context.board);
+    for (int y = 0; y < Board::data_size; ++y) {
+        for (const Color color : {Black, White}) {
+            const int first_plane = color == context.to_play ? 0 : Board::num_lib_planes;
+            uint32_t bits = stones[color - Black][y];
+            while (bits != 0) {
+                const int x = __builtin_ctz(bits);
+                bits &= bits - 1;
+                const int num_libs = num_liberties(context.board, x, y);
+                out.row(y, first_plane + std::min(num_libs, Board::num_lib_planes) - 1) |= 1u << x;
+            }
+        }
+    }
+}
+
+void MoveHistoryPlanes::compute(const FeatureContext& context, FeatureOutput out) {
+    // dist = 0 is the move just played, dist = 1 the one before, and so on.
+    const auto& moves = history(context.board);
+    for (int dist = 0; dist < num_planes && dist < moves.size(); ++dist) {
+        const auto& history_move = moves.rbegin()[dist];
+        if (!history_move.is_pass) {
+            out.row(history_move.coord.y + Board::padding, dist) |=
+                1u << (history_move.coord.x + Board::padding);
+        }
+    }
+}
+
+void LookaheadPlanes::compute(const FeatureContext& context, FeatureOutput out) {
+    for (int y = 0; y < Board::data_size; ++y) {
+        for (int i = 0; i < num_planes; ++i) {
+            out.row(y, i) = context.moves.lookahead[y][i];
+        }
+    }
+}
+
+void KomiScalar::compute(const FeatureContext& context, FeatureOutput out) {
+    const Board& board = context.board;
+    float bonus = board.komi;  // From White's perspective
+    if (board.ruleset.first_player_pass_bonus_rule == FirstPlayerPassBonusRule::Bonus) {
+        if (first_player_to_pass(board) == Black) {
+            bonus -= 0.5f;
+        } else if (first_player_to_pass(board) == White) {
+            bonus += 0.5f;
+        }
+    }
+    out.scalars[0] = (context.to_play == White ? bonus : -bonus) * points_normalization_factor;
+}
+
+void KoScalar::compute(const FeatureContext& context, FeatureOutput out) {
+    const auto& ko = context.moves.ko;
+    out.scalars[0] = static_cast<float>(
+        std::any_of(ko.begin(), ko.end(), [](uint32_t row) { return row != 0; }));
+}
+
+void ScoringScalar::compute(const FeatureContext& context, FeatureOutput out) {
+    out.scalars[0] = context.board.ruleset.scoring_rule == ScoringRule::Territory ? 1.0f : 0.0f;
+}
+
+void CaptureScalar::compute(const FeatureContext& context, FeatureOutput out) {
+    // num_captures is positive if Black captured more stones than White.
+    out.scalars[0] = (context.to_play == White ? -1.0f : 1.0f) *
+                     static_cast<float>(num_captures(context.board)) *
+                     points_normalization_factor;
+}
+
+void GameStageScalar::compute(const FeatureContext& context, FeatureOutput out) {
+    const Vec2 size = context.board.get_board_size();
+    out.scalars[0] = static_cast<float>(num_setup_stones(context.board) +
+                                        history(context.board).size()) /
+                     (size.x * size.y);
+}
+
+void PassHistoryScalars::compute(const FeatureContext& context, FeatureOutput out) {
+    const auto& moves = history(context.board);
+    for (int dist = 0; dist < num_scalars && dist < moves.size(); ++dist) {
+        out.scalars[dist] = static_cast<float>(moves.rbegin()[dist].is_pass);
+    }
+}
+
+}  // namespace go_data_gen
@@ -0,0 +1,425 @@
+#include "go_data_gen/file_reader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#ifdef GDG_HAVE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+namespace go_data_gen {
+
+namespace {
+
+// Buffer size of the first read. Files that fill it are read in further, doubling steps.
+constexpr size_t initial_read_size = 16 * 1024;
+
+}  // namespace
+
+#ifdef GDG_HAVE_IO_URING
+
+// Minimal io_uring wrapper on the raw system calls, so that liburing is not required.
+class FileReader::Ring {
+public:
+    explicit Ring(unsigned entries) {
+        io_uring_params params{};
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            throw std::runtime_error("io_uring_setup failed: " + std::string(std::strerror(errno)));
+        }
+        if (!supports_ops()) {
+            ::close(fd);
+            throw std::runtime_error("io_uring does not support open, read and close");
+        }
+
+        sq_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_size = cq_size = std::max(sq_size, cq_size);
+        }
+        sq_ptr = map(sq_size, IORING_OFF_SQ_RING);
+        cq_ptr = single_mmap ? sq_ptr : map(cq_size, IORING_OFF_CQ_RING);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(map(sqes_size, IORING_OFF_SQES));
+
+        auto* sq = static_cast<char*>(sq_ptr);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        auto* cq = static_cast<char*>(cq_ptr);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    ~Ring() {
+        munmap(sqes, sqes_size);
+        if (cq_ptr != sq_ptr) {
+            munmap(cq_ptr, cq_size);
+        }
+        munmap(sq_ptr, sq_size);
+        ::close(fd);
+    }
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    // The caller never has more operations in flight than entries, so the queue cannot overflow.
+    io_uring_sqe& get_sqe() {
+        const unsigned tail = *sq_tail + num_unsubmitted;
+        const unsigned index = tail & sq_mask;
+        sq_array[index] = index;
+        ++num_unsubmitted;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        return sqe;
+    }
+
+    // Submits queued operations and waits for at least one completion.
+    void submit_and_wait() {
+        __atomic_store_n(sq_tail, *sq_tail + num_unsubmitted, __ATOMIC_RELEASE);
+        const unsigned to_submit = num_unsubmitted;
+        num_unsubmitted = 0;
+        while (syscall(__NR_io_uring_enter, fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0) <
+               0) {
+            if (errno != EINTR) {
+                throw std::runtime_error("io_uring_enter failed: " +
+                                         std::string(std::strerror(errno)));
+            }
+        }
+    }
+
+    // Calls `func(user_data, res)` for every available completion.
+    template <typename Func>
+    void for_each_completion(Func&& func) {
+        unsigned head = *cq_head;
+        const unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes[head & cq_mask];
+            func(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+
+private:
+    int fd;
+    size_t sq_size, cq_size, sqes_size;
+    void* sq_ptr;
+    void* cq_ptr;
+    io_uring_sqe* sqes;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    io_uring_cqe* cqes;
+    unsigned num_unsubmitted = 0;
+
+    void* map(size_t size, off_t offset) {
+        void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                         offset);
+        if (ptr == MAP_FAILED) {
+            throw std::runtime_error("Could not map the io_uring queues");
+        }
+        return ptr;
+    }
+
+    bool supports_ops() const {
+        constexpr int num_ops = IORING_OP_LAST;
+        std::vector<char> buffer(sizeof(io_uring_probe) + num_ops * sizeof(io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, num_ops) < 0) {
+            return false;
+        }
+        for (const int op : {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE}) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+bool FileReader::is_io_uring_available() {
+    try {
+        Ring ring(1);
+        return true;
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+}
+
+#else
+
+class FileReader::Ring {};
+
+bool FileReader::is_io_uring_available() { return false; }
+
+#endif
+
+FileReader::FileReader(std::vector<std::string> _paths, int _queue_depth, int _capacity,
+                       IoBackend _backend, PrefixFilter _prefix_filter)
+    : paths{std::move(_paths)},
+      queue_depth{_queue_depth},
+      capacity{std::max(_capacity, _queue_depth)},
+      backend{_backend},
+      prefix_filter{std::move(_prefix_filter)} {
+    if (queue_depth < 1) {
+        throw std::runtime_error("Queue depth must be >= 1");
+    }
+
+    std::unique_ptr<Ring> ring;
+#ifdef GDG_HAVE_IO_URING
+    if (backend != IoBackend::Threads) {
+        try {
+            ring = std::make_unique<Ring>(queue_depth);
+        } catch (const std::runtime_error&) {
+            if (backend == IoBackend::IoUring) {
+                throw;
+            }
+        }
+    }
+#endif
+    if (backend == IoBackend::IoUring && !ring) {
+        throw std::runtime_error("io_uring is not available in this build");
+    }
+    backend = ring ? IoBackend::IoUring : IoBackend::Threads;
+
+    if (backend == IoBackend::IoUring) {
+        threads.emplace_back([this, ring = std::move(ring)]() { run_io_uring(*ring); });
+    } else {
+        for (int i = 0; i < queue_depth; ++i) {
+            threads.emplace_back([this]() { run_threads(); });
+        }
+    }
+}
+
+FileReader::~FileReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    space_cv.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+bool FileReader::next(File& file) {
+    std::unique_lock<std::mutex> lock(mutex);
+    ready_cv.wait(lock, [&] { return !ready.empty() || num_returned == paths.size(); });
+    if (ready.empty()) {
+        return false;
+    }
+    file = std::move(ready.front());
+    ready.pop_front();
+    --num_reserved;
+    ++num_returned;
+    const bool is_done = num_returned == paths.size();
+    lock.unlock();
+    space_cv.notify_one();
+    if (is_done) {
+        ready_cv.notify_all();
+    }
+    return true;
+}
+
+bool FileReader::reserve() {
+    std::unique_lock<std::mutex> lock(mutex);
+    space_cv.wait(lock, [&] { return stopping || num_reserved < static_cast<size_t>(capacity); });
+    if (stopping) {
+        return false;
+    }
+    ++num_reserved;
+    return true;
+}
+
+void FileReader::complete(File file) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(std::move(file));
+    }
+    ready_cv.notify_one();
+}
+
+void FileReader::run_threads() {
+    while (true) {
+        // Reserve first, so that no index is taken that cannot be read.
+        if (!reserve()) {
+            return;
+        }
+        const size_t index = next_index++;
+        if (index >= paths.size()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            --num_reserved;
+            return;
+        }
+
+        File file{index, {}, 0};
+        const int fd = ::open(paths[index].c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            file.error = errno;
+        } else {
+            size_t size = 0;
+            file.content.resize(initial_read_size);
+            while (true) {
+                if (size == file.content.size()) {
+                    file.content.resize(2 * size);
+                }
+                const ssize_t result =
+                    ::read(fd, file.content.data() + size, file.content.size() - size);
+                if (result < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (result <= 0) {
+                    file.error = result < 0 ? errno : 0;
+                    break;
+                }
+                size += result;
+                // Only the first read fills exactly the initial buffer, later ones double it.
+                if (size == initial_read_size && prefix_filter &&
+                    !prefix_filter(std::string_view(file.content.data(), size))) {
+                    file.is_prefix = true;
+                    break;
+                }
+            }
+            file.content.resize(size);
+            ::close(fd);
+        }
+        complete(std::move(file));
+    }
+}
+
+#ifdef GDG_HAVE_IO_URING
+
+void FileReader::run_io_uring(Ring& ring) {
+    // Each slot reads one file at a time: open, read until end of file, then close. Every slot has
+    // at most one operation in flight.
+    enum class Stage { Open, Read, Close };
+    struct Slot {
+        Stage stage;
+        int fd;
+        size_t size;
+        File file;
+    };
+    std::vector<Slot> slots(queue_depth);
+    std::vector<int> free_slots;
+    for (int i = queue_depth - 1; i >= 0; --i) {
+        free_slots.push_back(i);
+    }
+
+    auto submit_read = [&](int slot_index) {
+        Slot& slot = slots[slot_index];
+        slot.stage = Stage::Read;
+        if (slot.size == slot.file.content.size()) {
+            slot.file.content.resize(std::max(2 * slot.size, initial_read_size));
+        }
+        io_uring_sqe& sqe = ring.get_sqe();
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = slot.fd;
+        sqe.addr = reinterpret_cast<uint64_t>(slot.file.content.data() + slot.size);
+        sqe.len = static_cast<uint32_t>(slot.file.content.size() - slot.size);
+        sqe.off = slot.size;
+        sqe.user_data = slot_index;
+    };
+    auto submit_close = [&](int slot_index) {
+        Slot& slot = slots[slot_index];
+        slot.stage = Stage::Close;
+        io_uring_sqe& sqe = ring.get_sqe();
+        sqe.opcode = IORING_OP_CLOSE;
+        sqe.fd = slot.fd;
+        sqe.user_data = slot_index;
+    };
+    auto finish = [&](int slot_index) {
+        Slot& slot = slots[slot_index];
+        slot.file.content.resize(slot.size);
+        complete(std::move(slot.file));
+        free_slots.push_back(slot_index);
+    };
+
+    int num_in_flight = 0;
+    while (true) {
+        // Start new files while there are free slots. Only block for space if nothing is in flight.
+        while (!free_slots.empty() && next_index < paths.size()) {
+            if (num_in_flight > 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stopping || num_reserved >= static_cast<size_t>(capacity)) {
+                    break;
+                }
+                ++num_reserved;
+            } else if (!reserve()) {
+                break;
+            }
+            const int slot_index = free_slots.back();
+            free_slots.pop_back();
+            Slot& slot = slots[slot_index];
+            slot = Slot{Stage::Open, -1, 0, File{next_index++, {}, 0}};
+            io_uring_sqe& sqe = ring.get_sqe();
+            sqe.opcode = IORING_OP_OPENAT;
+            sqe.fd = AT_FDCWD;
+            sqe.addr = reinterpret_cast<uint64_t>(paths[slot.file.index].c_str());
+            sqe.open_flags = O_RDONLY | O_CLOEXEC;
+            sqe.user_data = slot_index;
+            ++num_in_flight;
+        }
+        if (num_in_flight == 0) {
+            return;
+        }
+
+        ring.submit_and_wait();
+        ring.for_each_completion([&](uint64_t user_data, int result) {
+            const int slot_index = static_cast<int>(user_data);
+            Slot& slot = slots[slot_index];
+            switch (slot.stage) {
+            case Stage::Open:
+                if (result < 0) {
+                    slot.file.error = -result;
+                    finish(slot_index);
+                    --num_in_flight;
+                } else {
+                    slot.fd = result;
+                    submit_read(slot_index);
+                }
+                break;
+            case Stage::Read:
+                if (result > 0) {
+                    slot.size += result;
+                    if (slot.size == initial_read_size && prefix_filter &&
+                        !prefix_filter(std::string_view(slot.file.content.data(), slot.size))) {
+                        slot.file.is_prefix = true;
+                        submit_close(slot_index);
+                    } else {
+                        submit_read(slot_index);
+                    }
+                } else {
+                    slot.file.error = -result;
+                    submit_close(slot_index);
+                }
+                break;
+            case Stage::Close:
+                finish(slot_index);
+                --num_in_flight;
+                break;
+            }
+        });
+    }
+}
+
+#else
+
+void FileReader::run_io_uring(Ring&) {}
+
+#endif
+
+}  // namespace go_data_gen
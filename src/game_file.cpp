@@ -0,0 +1,415 @@
+#include "go_data_gen/game_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "go_data_gen/zobrist.hpp"
+
+namespace {
+
+using go_data_gen::Board;
+using go_data_gen::Color;
+using go_data_gen::Move;
+
+constexpr char file_magic[8] = {'G', 'D', 'G', 'G', 'A', 'M', 'E', 'S'};
+constexpr uint32_t file_version = 2;
+
+// Move codes: bits 0-8 hold y * max_board_size + x, or pass_point for passes. Bits 9-10 hold the
+// color.
+constexpr uint16_t pass_point = 0x1ff;
+
+uint16_t encode_move(const Move& move) {
+    const int point =
+        move.is_pass ? pass_point : move.coord.y * Board::max_board_size + move.coord.x;
+    return static_cast<uint16_t>(point | move.color << 9);
+}
+
+Move decode_move(uint16_t code, go_data_gen::Vec2 board_size) {
+    const int color = code >> 9;
+    if (color != go_data_gen::Black && color != go_data_gen::White) {
+        throw std::runtime_error("Invalid move code in game file");
+    }
+    const int point = code & pass_point;
+    if (point == pass_point) {
+        return Move{static_cast<Color>(color), true, {0, 0}};
+    }
+    const go_data_gen::Vec2 coord{point % Board::max_board_size, point / Board::max_board_size};
+    if (coord.x >= board_size.x || coord.y >= board_size.y) {
+        throw std::runtime_error("Move off the board in game file");
+    }
+    return Move{static_cast<Color>(color), false, coord};
+}
+
+template <typename T>
+void write_pod(std::ofstream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T read_pod(std::ifstream& in) {
+    T value{};
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return value;
+}
+
+template <typename T>
+void write_array(std::ofstream& out, const std::vector<T>& values) {
+    out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+template <typename T>
+void read_array(std::ifstream& in, std::vector<T>& values, size_t size) {
+    values.resize(size);
+    in.read(reinterpret_cast<char*>(values.data()), size * sizeof(T));
+}
+
+void write_moves(std::ofstream& out, const std::vector<Move>& moves) {
+    std::vector<uint16_t> codes(moves.size());
+    std::transform(moves.begin(), moves.end(), codes.begin(), encode_move);
+    write_pod(out, static_cast<uint32_t>(codes.size()));
+    write_array(out, codes);
+}
+
+std::vector<Move> read_moves(std::ifstream& in, size_t num_moves,
+                             go_data_gen::Vec2 board_size) {
+    std::vector<uint16_t> codes;
+    read_array(in, codes, num_moves);
+    std::vector<Move> moves;
+    moves.reserve(codes.size());
+    for (const uint16_t code : codes) {
+        moves.push_back(decode_move(code, board_size));
+    }
+    return moves;
+}
+
+// Whether all packed points are empty, black or white.
+bool is_valid_packed_stones(const std::vector<uint8_t>& packed, go_data_gen::Vec2 board_size) {
+    for (int i = 0; i < board_size.x * board_size.y; ++i) {
+        if (((packed[i / 4] >> (i % 4 * 2)) & 3) == go_data_gen::OffBoard) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Stones are packed with 2 bits per point, row-major over the board size.
+std::vector<uint8_t> pack_stone_rows(const Board::StoneRows& rows, go_data_gen::Vec2 board_size) {
+    std::vector<uint8_t> packed((board_size.x * board_size.y + 3) / 4, 0);
+    for (int y = 0; y < board_size.y; ++y) {
+        for (int x = 0; x < board_size.x; ++x) {
+            const int i = y * board_size.x + x;
+            const uint32_t bit = 1u << (x + Board::padding);
+            int color = go_data_gen::Empty;
+            if (rows[0][y + Board::padding] & bit) {
+                color = go_data_gen::Black;
+            } else if (rows[1][y + Board::padding] & bit) {
+                color = go_data_gen::White;
+            }
+            packed[i / 4] |= static_cast<uint8_t>(color << (i % 4 * 2));
+        }
+    }
+    return packed;
+}
+
+Board::StoneRows unpack_stone_rows(const std::vector<uint8_t>& packed,
+                                   go_data_gen::Vec2 board_size) {
+    Board::StoneRows rows{};
+    for (int y = 0; y < board_size.y; ++y) {
+        for (int x = 0; x < board_size.x; ++x) {
+            const int i = y * board_size.x + x;
+            const int color = (packed[i / 4] >> (i % 4 * 2)) & 3;
+            if (color == go_data_gen::Black || color == go_data_gen::White) {
+                rows[color - go_data_gen::Black][y + Board::padding] |= 1u << (x + Board::padding);
+            }
+        }
+    }
+    return rows;
+}
+
+}  // namespace
+
+namespace go_data_gen {
+
+void GameRecord::get_position(int move_index, Board& board) const {
+    if (move_index < 0 || move_index > static_cast<int>(moves.size())) {
+        throw std::runtime_error("Move index out of range: " + std::to_string(move_index));
+    }
+    // Replay enough moves to also fill the stone history, if the game is long enough.
+    const int first_history_move = std::max(0, move_index - (Board::max_stone_history - 1));
+    const int checkpoint_index = std::min<int>(first_history_move / checkpoint_interval,
+                                               static_cast<int>(checkpoints.size()) - 1);
+    const Checkpoint& checkpoint = checkpoints[checkpoint_index];
+    const int checkpoint_move = checkpoint_index * checkpoint_interval;
+
+    Board::State state;
+    state.stones.resize(board_size.x * board_size.y);
+    for (size_t i = 0; i < state.stones.size(); ++i) {
+        state.stones[i] = static_cast<Color>((checkpoint.stones[i / 4] >> (i % 4 * 2)) & 3);
+    }
+    state.history = start_history;
+    state.history.insert(state.history.end(), moves.begin(), moves.begin() + checkpoint_move);
+    state.zobrist = checkpoint.zobrist;
+    state.zobrist_history.assign(
+        hashes.begin() + checkpoint.hashes_end - checkpoint.zobrist_history_size,
+        hashes.begin() + checkpoint.hashes_end);
+    state.first_player_to_pass = checkpoint.first_player_to_pass;
+    state.num_captures = checkpoint.num_captures;
+    state.num_setup_stones = num_setup_stones;
+    if (checkpoint_index == 0) {
+        for (const auto& packed : start_stone_history) {
+            state.stone_history.push_back(unpack_stone_rows(packed, board_size));
+        }
+    }
+
+    board = Board(board_size, komi, ruleset, num_handicap_stones);
+    board.set_state(state);
+    for (int i = checkpoint_move; i < move_index; ++i) {
+        if (!board.is_legal(moves[i])) {
+            throw std::runtime_error("Illegal move " + std::to_string(i) + " in game record");
+        }
+        board.play(moves[i]);
+    }
+}
+
+GameWriter::GameWriter(const std::string& _path, int _checkpoint_interval)
+    : out{_path, std::ios::binary | std::ios::trunc},
+      path{_path},
+      checkpoint_interval{_checkpoint_interval} {
+    if (!out.is_open()) {
+        throw std::runtime_error("Could not open the file: " + path);
+    }
+    if (checkpoint_interval < 1 || checkpoint_interval > UINT16_MAX) {
+        throw std::runtime_error("Invalid checkpoint interval");
+    }
+    out.write(file_magic, sizeof(file_magic));
+    write_pod(out, file_version);
+    write_pod(out, get_zobrist_seed());
+}
+
+GameWriter::~GameWriter() {
+    if (out.is_open()) {
+        try {
+            close();
+        } catch (const std::exception&) {
+            // Destructors must not throw. Call close() explicitly to see errors.
+        }
+    }
+}
+
+void GameWriter::add_game(const Board& start, const std::vector<Move>& moves, float result) {
+    Board board = start;
+    const Vec2 board_size = board.get_board_size();
+    const Board::State start_state = board.get_state();
+
+    // Only the zobrist history entries that are new since the previous checkpoint are stored.
+    std::vector<uint64_t> hashes;
+    std::vector<uint64_t> previous_zobrist_history;
+    std::vector<GameRecord::Checkpoint> checkpoints;
+    auto add_checkpoint = [&]() {
+        const Board::State state = board.get_state();
+        GameRecord::Checkpoint checkpoint;
+        checkpoint.stones.assign((state.stones.size() + 3) / 4, 0);
+        for (size_t i = 0; i < state.stones.size(); ++i) {
+            checkpoint.stones[i / 4] |= static_cast<uint8_t>(state.stones[i] << (i % 4 * 2));
+        }
+        checkpoint.num_captures = state.num_captures;
+        checkpoint.first_player_to_pass = state.first_player_to_pass;
+        checkpoint.zobrist = state.zobrist;
+
+        const auto& zobrist_history = state.zobrist_history;
+        const bool extends_previous =
+            zobrist_history.size() >= previous_zobrist_history.size() &&
+            std::equal(previous_zobrist_history.begin(), previous_zobrist_history.end(),
+                       zobrist_history.begin());
+        const size_t num_kept = extends_previous ? previous_zobrist_history.size() : 0;
+        hashes.insert(hashes.end(), zobrist_history.begin() + num_kept, zobrist_history.end());
+        checkpoint.zobrist_history_size = static_cast<uint32_t>(zobrist_history.size());
+        checkpoint.hashes_end = static_cast<uint32_t>(hashes.size());
+        previous_zobrist_history = zobrist_history;
+        checkpoints.push_back(std::move(checkpoint));
+    };
+
+    for (size_t i = 0; i < moves.size(); ++i) {
+        if (i % checkpoint_interval == 0) {
+            add_checkpoint();
+        }
+        if (!board.is_legal(moves[i])) {
+            throw std::runtime_error("Illegal move in game for " + path);
+        }
+        board.play(moves[i]);
+    }
+    if (moves.size() % checkpoint_interval == 0) {
+        add_checkpoint();
+    }
+
+    game_offsets.push_back(static_cast<uint64_t>(out.tellp()));
+    write_pod(out, static_cast<int8_t>(board_size.x));
+    write_pod(out, static_cast<int8_t>(board_size.y));
+    write_pod(out, board.komi);
+    write_pod(out, static_cast<uint8_t>(board.ruleset.ko_rule));
+    write_pod(out, static_cast<uint8_t>(board.ruleset.suicide_rule));
+    write_pod(out, static_cast<uint8_t>(board.ruleset.scoring_rule));
+    write_pod(out, static_cast<uint8_t>(board.ruleset.tax_rule));
+    write_pod(out, static_cast<uint8_t>(board.ruleset.first_player_pass_bonus_rule));
+    write_pod(out, static_cast<int16_t>(board.num_handicap_stones));
+    write_pod(out, result);
+    write_pod(out, static_cast<uint16_t>(checkpoint_interval));
+    write_pod(out, static_cast<uint16_t>(start_state.num_setup_stones));
+    write_moves(out, start_state.history);
+    write_pod(out, static_cast<uint8_t>(start_state.stone_history.size()));
+    for (const auto& stone_rows : start_state.stone_history) {
+        write_array(out, pack_stone_rows(stone_rows, board_size));
+    }
+    write_moves(out, moves);
+    write_pod(out, static_cast<uint32_t>(hashes.size()));
+    write_array(out, hashes);
+    write_pod(out, static_cast<uint32_t>(checkpoints.size()));
+    for (const auto& checkpoint : checkpoints) {
+        write_array(out, checkpoint.stones);
+        write_pod(out, static_cast<int16_t>(checkpoint.num_captures));
+        write_pod(out, static_cast<uint8_t>(checkpoint.first_player_to_pass));
+        write_pod(out, checkpoint.zobrist);
+        write_pod(out, checkpoint.zobrist_history_size);
+        write_pod(out, checkpoint.hashes_end);
+    }
+    if (!out) {
+        throw std::runtime_error("Could not write the game file: " + path);
+    }
+}
+
+void GameWriter::close() {
+    // The game table is at the end, followed by the number of games.
+    write_array(out, game_offsets);
+    write_pod(out, static_cast<uint64_t>(game_offsets.size()));
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Could not write the game file: " + path);
+    }
+}
+
+GameReader::GameReader(const std::string& _path) : in{_path, std::ios::binary}, path{_path} {
+    if (!in.is_open()) {
+        throw std::runtime_error("Could not open the file: " + path);
+    }
+
+    char magic[sizeof(file_magic)];
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, file_magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not a game file: " + path);
+    }
+    if (read_pod<uint32_t>(in) != file_version) {
+        throw std::runtime_error("Unsupported game file version: " + path);
+    }
+    if (read_pod<uint64_t>(in) != get_zobrist_seed()) {
+        throw std::runtime_error("Game file was written with a different zobrist seed: " + path);
+    }
+
+    // The game table and its count follow the header, so they bound the number of games.
+    const auto header_size = static_cast<uint64_t>(in.tellg());
+    in.seekg(-static_cast<std::streamoff>(sizeof(uint64_t)), std::ios::end);
+    const auto num_games = read_pod<uint64_t>(in);
+    const auto file_size = static_cast<uint64_t>(in.tellg());
+    if (!in || file_size < header_size + sizeof(uint64_t) ||
+        num_games > (file_size - header_size - sizeof(uint64_t)) / sizeof(uint64_t)) {
+        throw std::runtime_error("Truncated game file: " + path);
+    }
+    table_offset = file_size - (num_games + 1) * sizeof(uint64_t);
+    in.seekg(table_offset);
+    read_array(in, game_offsets, num_games);
+    if (!in) {
+        throw std::runtime_error("Truncated game file: " + path);
+    }
+}
+
+GameRecord GameReader::read_game(size_t index) {
+    if (index >= game_offsets.size()) {
+        throw std::runtime_error("Game index out of range: " + std::to_string(index));
+    }
+    const std::string corrupt = "Corrupt game record in " + path;
+    if (game_offsets[index] >= table_offset) {
+        throw std::runtime_error(corrupt);
+    }
+    in.seekg(game_offsets[index]);
+    // Counts are checked against the bytes left before the game table, so that a corrupt count
+    // fails instead of allocating.
+    auto read_count = [&](size_t element_size) -> size_t {
+        const auto count = read_pod<uint32_t>(in);
+        if (!in || static_cast<uint64_t>(in.tellg()) > table_offset ||
+            count > (table_offset - static_cast<uint64_t>(in.tellg())) / element_size) {
+            throw std::runtime_error(corrupt);
+        }
+        return count;
+    };
+
+    GameRecord game;
+    game.board_size.x = read_pod<int8_t>(in);
+    game.board_size.y = read_pod<int8_t>(in);
+    if (game.board_size.x < 1 || game.board_size.y < 1 ||
+        game.board_size.x > Board::max_board_size || game.board_size.y > Board::max_board_size) {
+        throw std::runtime_error(corrupt);
+    }
+    const int num_points = game.board_size.x * game.board_size.y;
+    game.komi = read_pod<float>(in);
+    uint8_t rules[5];
+    in.read(reinterpret_cast<char*>(rules), sizeof(rules));
+    if (rules[0] > 2 || rules[1] > 1 || rules[2] > 1 || rules[3] > 2 || rules[4] > 1) {
+        throw std::runtime_error(corrupt);
+    }
+    game.ruleset.ko_rule = static_cast<KoRule>(rules[0]);
+    game.ruleset.suicide_rule = static_cast<SuicideRule>(rules[1]);
+    game.ruleset.scoring_rule = static_cast<ScoringRule>(rules[2]);
+    game.ruleset.tax_rule = static_cast<TaxRule>(rules[3]);
+    game.ruleset.first_player_pass_bonus_rule = static_cast<FirstPlayerPassBonusRule>(rules[4]);
+    game.num_handicap_stones = read_pod<int16_t>(in);
+    game.result = read_pod<float>(in);
+    game.checkpoint_interval = read_pod<uint16_t>(in);
+    game.num_setup_stones = read_pod<uint16_t>(in);
+    if (game.num_handicap_stones < 0 || game.num_handicap_stones > num_points ||
+        game.num_setup_stones > num_points || game.checkpoint_interval < 1) {
+        throw std::runtime_error(corrupt);
+    }
+    game.start_history = read_moves(in, read_count(sizeof(uint16_t)), game.board_size);
+    const size_t packed_size = (num_points + 3) / 4;
+    game.start_stone_history.resize(read_pod<uint8_t>(in));
+    if (game.start_stone_history.size() >= Board::max_stone_history) {
+        throw std::runtime_error(corrupt);
+    }
+    for (auto& packed : game.start_stone_history) {
+        read_array(in, packed, packed_size);
+        if (!is_valid_packed_stones(packed, game.board_size)) {
+            throw std::runtime_error(corrupt);
+        }
+    }
+    game.moves = read_moves(in, read_count(sizeof(uint16_t)), game.board_size);
+    read_array(in, game.hashes, read_count(sizeof(uint64_t)));
+
+    // The writer stores a checkpoint before every checkpoint_interval-th move and after the last.
+    game.checkpoints.resize(read_count(packed_size + sizeof(int16_t) + sizeof(uint8_t) +
+                                       sizeof(uint64_t) + 2 * sizeof(uint32_t)));
+    if (game.checkpoints.size() != game.moves.size() / game.checkpoint_interval + 1) {
+        throw std::runtime_error(corrupt);
+    }
+    for (auto& checkpoint : game.checkpoints) {
+        read_array(in, checkpoint.stones, packed_size);
+        checkpoint.num_captures = read_pod<int16_t>(in);
+        const auto first_player_to_pass = read_pod<uint8_t>(in);
+        checkpoint.zobrist = read_pod<uint64_t>(in);
+        checkpoint.zobrist_history_size = read_pod<uint32_t>(in);
+        checkpoint.hashes_end = read_pod<uint32_t>(in);
+        if (!is_valid_packed_stones(checkpoint.stones, game.board_size) ||
+            (first_player_to_pass != Empty && first_player_to_pass != Black &&
+             first_player_to_pass != White) ||
+            checkpoint.hashes_end > game.hashes.size() ||
+            checkpoint.zobrist_history_size > checkpoint.hashes_end) {
+            throw std::runtime_error(corrupt);
+        }
+        checkpoint.first_player_to_pass = static_cast<Color>(first_player_to_pass);
+    }
+    if (!in || static_cast<uint64_t>(in.tellg()) > table_offset) {
+        throw std::runtime_error(corrupt);
+    }
+    return game;
+}
+
+}  // namespace go_data_gen
@@ -0,0 +1,337 @@
+#include "go_data_gen/incremental_featurizer.hpp"
+
+#include <algorithm>
+
+#include "go_data_gen/feature_expand.hpp"
+#include "go_data_gen/feature_set.hpp"
+
+namespace {
+
+using go_data_gen::Board;
+using go_data_gen::Color;
+using BitRows = std::array<uint32_t, Board::data_size>;
+
+int color_index(Color color) { return color - go_data_gen::Black; }
+
+// Adds the 4-neighbors of all set bits. Rows of the padding never hold stones, so they are skipped
+// as sources.
+BitRows dilate(const BitRows& bits) {
+    BitRows result = bits;
+    for (int y = 1; y < Board::data_size - 1; ++y) {
+        result[y] |= bits[y] << 1 | bits[y] >> 1 | bits[y - 1] | bits[y + 1];
+    }
+    return result;
+}
+
+// The connected set of bits of `mask` that contains (x, y).
+BitRows flood_fill(const BitRows& mask, int x, int y) {
+    BitRows region{};
+    region[y] = 1u << x;
+    bool grown = true;
+    while (grown) {
+        grown = false;
+        for (int row = 1; row < Board::data_size - 1; ++row) {
+            const uint32_t next = (region[row] | region[row] << 1 | region[row] >> 1 |
+                                   region[row - 1] | region[row + 1]) &
+                                  mask[row];
+            if (next != region[row]) {
+                region[row] = next;
+                grown = true;
+            }
+        }
+    }
+    return region;
+}
+
+}  // namespace
+
+namespace go_data_gen {
+
+IncrementalFeaturizer::IncrementalFeaturizer(Board& _board, Color _to_play)
+    : board{_board}, to_play{_to_play} {
+    refresh();
+}
+
+void IncrementalFeaturizer::refresh() {
+    on_board = {};
+    stones = {};
+    for (int y = 0; y < Board::data_size; ++y) {
+        for (int x = 0; x < Board::data_size; ++x) {
+            const auto color = static_cast<Color>(board.board[Board::to_point(x, y)]);
+            on_board[y] |= (color != OffBoard) ? 1u << x : 0;
+            if (color == Black || color == White) {
+                stones[color_index(color)][y] |= 1u << x;
+            }
+        }
+    }
+
+    libs = {};
+    legal = {};
+    ko = {};
+    lookahead = {};
+    dirty = {};
+    BitRows all_stones;
+    for (int y = 0; y < Board::data_size; ++y) {
+        all_stones[y] = stones[0][y] | stones[1][y];
+    }
+    update_groups(all_stones);
+
+    legality_valid = {false, false};
+    previous_positions.clear();
+    num_synced_positions = 0;
+    update_legality();
+
+    rows = assemble_rows();
+    expand_rows_hwc(&rows[0][0], Board::data_size, Board::data_size, Board::num_feature_planes,
+                    &planes[0][0][0]);
+    changes.clear();
+}
+
+void IncrementalFeaturizer::play(Move move) {
+    board.play(move);
+    to_play = opposite(move.color);
+
+    if (!move.is_pass) {
+        const int x = move.coord.x + Board::padding;
+        const int y = move.coord.y + Board::padding;
+        BitRows changed{};
+        changed[y] = 1u << x;
+        stones[color_index(move.color)][y] |= 1u << x;
+
+        // Captured groups, including the played stone in case of suicide, are next to it.
+        const std::array<std::array<int, 2>, 5> candidates{
+            {{x, y}, {x - 1, y}, {x + 1, y}, {x, y - 1}, {x, y + 1}}};
+        for (const auto& [cx, cy] : candidates) {
+            if (static_cast<Color>(board.board[Board::to_point(cx, cy)]) != Empty) {
+                continue;
+            }
+            for (auto& color_stones : stones) {
+                if (!(color_stones[cy] >> cx & 1)) {
+                    continue;
+                }
+                const BitRows captured = flood_fill(color_stones, cx, cy);
+                for (int row = 0; row < Board::data_size; ++row) {
+                    color_stones[row] &= ~captured[row];
+                    for (auto& color_libs : libs) {
+                        for (auto& lib_rows : color_libs) {
+                            lib_rows[row] &= ~captured[row];
+                        }
+                    }
+                    changed[row] |= captured[row];
+                }
+            }
+        }
+
+        // Groups next to changed points gained or lost liberties.
+        const BitRows neighborhood = dilate(changed);
+        BitRows affected;
+        for (int row = 0; row < Board::data_size; ++row) {
+            affected[row] = neighborhood[row] & (stones[0][row] | stones[1][row]);
+            dirty[0][row] |= neighborhood[row];
+            dirty[1][row] |= neighborhood[row];
+        }
+        update_groups(affected);
+    }
+
+    update_legality();
+
+    // Apply the difference to the planes.
+    changes.clear();
+    const auto new_rows = assemble_rows();
+    for (int row = 0; row < Board::data_size; ++row) {
+        for (int plane = 0; plane < Board::num_feature_planes; ++plane) {
+            uint32_t diff = new_rows[row][plane] ^ rows[row][plane];
+            while (diff != 0) {
+                const int col = __builtin_ctz(diff);
+                diff &= diff - 1;
+                const uint8_t value = (new_rows[row][plane] >> col) & 1;
+                planes[row][col][plane] = static_cast<float>(value);
+                changes.push_back(Change{static_cast<uint8_t>(row), static_cast<uint8_t>(col),
+                                         static_cast<uint8_t>(plane), value});
+            }
+        }
+    }
+    rows = new_rows;
+}
+
+void IncrementalFeaturizer::update_groups(const BitRows& stones_to_update) {
+    // Each group is updated once, even if several of its stones are given.
+    BitRows done{};
+    for (int y = 0; y < Board::data_size; ++y) {
+        uint32_t bits = stones_to_update[y];
+        while (bits != 0) {
+            const int x = __builtin_ctz(bits);
+            bits &= bits - 1;
+            if (done[y] >> x & 1) {
+                continue;
+            }
+
+            const Board::Point root = board.find(Board::to_point(x, y));
+            const auto color = static_cast<Color>(board.board[root]);
+            const int num_libs = board.liberties[root].size();
+            const int lib_plane = std::min(num_libs, Board::num_lib_planes) - 1;
+            auto& color_libs = libs[color_index(color)];
+            for (const Board::Point stone : board.group[root]) {
+                const int stone_y = Board::point_y(stone);
+                const uint32_t bit = 1u << Board::point_x(stone);
+                for (auto& lib_rows : color_libs) {
+                    lib_rows[stone_y] &= ~bit;
+                }
+                color_libs[lib_plane][stone_y] |= bit;
+                done[stone_y] |= bit;
+            }
+
+            // Moves on the liberties of the group may have become (il)legal.
+            for (const Board::Point liberty : board.liberties[root]) {
+                const uint32_t bit = 1u << Board::point_x(liberty);
+                dirty[0][Board::point_y(liberty)] |= bit;
+                dirty[1][Board::point_y(liberty)] |= bit;
+            }
+        }
+    }
+}
+
+void IncrementalFeaturizer::update_legality() {
+    // Legality can only be computed for the side to move, so the other color is updated on its
+    // turn, from the points that changed in the meantime.
+    const int index = color_index(to_play);
+    const bool superko = board.ruleset.ko_rule != KoRule::Simple;
+    if (superko) {
+        sync_previous_positions();
+    }
+
+    BitRows empty;
+    for (int y = 0; y < Board::data_size; ++y) {
+        empty[y] = on_board[y] & ~(stones[0][y] | stones[1][y]);
+    }
+    // Moves next to an empty point that capture nothing only depend on the ko history.
+    BitRows simple{};
+    const auto& opp_atari = libs[1 - index][0];
+    for (int y = 1; y < Board::data_size - 1; ++y) {
+        simple[y] = empty[y] & (empty[y] << 1 | empty[y] >> 1 | empty[y - 1] | empty[y + 1]) &
+                    ~(opp_atari[y] << 1 | opp_atari[y] >> 1 | opp_atari[y - 1] | opp_atari[y + 1]);
+    }
+
+    auto& color_dirty = dirty[index];
+    // The lookahead only depends on the groups around a point, unlike legality also on the ko
+    // history. It is kept for all empty points and masked with the legal moves when assembled.
+    BitRows changed_groups;
+    for (int y = 0; y < Board::data_size; ++y) {
+        if (!legality_valid[index]) {
+            color_dirty[y] = on_board[y];
+        }
+        changed_groups[y] = color_dirty[y];
+        if (superko) {
+            // Superko can repeat any earlier position, so all empty points are checked.
+            color_dirty[y] |= empty[y];
+        } else {
+            // Ko points expire, and new ones are always at just-captured stones.
+            color_dirty[y] |= ko[index][y];
+        }
+        legal[index][y] &= ~color_dirty[y];
+        ko[index][y] &= ~color_dirty[y];
+        for (auto& lookahead_row : lookahead[index][y]) {
+            lookahead_row &= ~changed_groups[y];
+        }
+    }
+
+    for (int y = 0; y < Board::data_size; ++y) {
+        uint32_t bits = color_dirty[y] & empty[y];
+        while (bits != 0) {
+            const int x = __builtin_ctz(bits);
+            bits &= bits - 1;
+            const Board::Point point = Board::to_point(x, y);
+            const bool is_changed = changed_groups[y] >> x & 1;
+            MoveLegality legality;
+            if (superko && (simple[y] >> x & 1)) {
+                const uint64_t hash = board.get_history_hash(
+                    board.zobrist ^ Board::get_stone_hash(point, to_play), to_play);
+                legality =
+                    previous_positions.count(hash) ? MoveLegality::Ko : MoveLegality::Legal;
+                if (is_changed) {
+                    Board::set_lookahead_bits(board.get_move_lookahead(
+                                                  point, to_play,
+                                                  board.get_neighbor_groups(point, to_play)),
+                                              1u << x, lookahead[index][y].data());
+                }
+            } else {
+                const auto neighbors = board.get_neighbor_groups(point, to_play);
+                legality = board.get_move_legality(point, to_play, neighbors);
+                if (is_changed) {
+                    Board::set_lookahead_bits(board.get_move_lookahead(point, to_play, neighbors),
+                                              1u << x, lookahead[index][y].data());
+                }
+            }
+            legal[index][y] |= (legality == MoveLegality::Legal) ? 1u << x : 0;
+            ko[index][y] |= (legality == MoveLegality::Ko) ? 1u << x : 0;
+        }
+    }
+    color_dirty = {};
+    legality_valid[index] = true;
+}
+
+Board::FeatureVector IncrementalFeaturizer::get_feature_scalars() const {
+    using Scalars = DefaultFeatureScalars;
+    static_assert(KomiScalar::num_scalars + KoScalar::num_scalars + ScoringScalar::num_scalars +
+                      CaptureScalar::num_scalars + GameStageScalar::num_scalars +
+                      PassHistoryScalars::num_scalars ==
+                  Scalars::num_scalars);
+
+    Board::FeatureVector scalars{};
+    const FeatureContext context{board, to_play, {}};
+    auto output = [&](int offset) { return FeatureOutput{nullptr, 0, scalars.data() + offset}; };
+    KomiScalar::compute(context, output(Scalars::scalar_offset<KomiScalar>()));
+    ScoringScalar::compute(context, output(Scalars::scalar_offset<ScoringScalar>()));
+    CaptureScalar::compute(context, output(Scalars::scalar_offset<CaptureScalar>()));
+    GameStageScalar::compute(context, output(Scalars::scalar_offset<GameStageScalar>()));
+    PassHistoryScalars::compute(context, output(Scalars::scalar_offset<PassHistoryScalars>()));
+    const auto& own_ko = ko[color_index(to_play)];
+    scalars[Scalars::scalar_offset<KoScalar>()] = static_cast<float>(
+        std::any_of(own_ko.begin(), own_ko.end(), [](uint32_t row) { return row != 0; }));
+    return scalars;
+}
+
+void IncrementalFeaturizer::sync_previous_positions() {
+    // The history only grows by one entry per move, or is cleared by a pass.
+    const auto& history = board.zobrist_history;
+    if (history.size() < num_synced_positions) {
+        previous_positions.clear();
+        num_synced_positions = 0;
+    }
+    previous_positions.insert(history.begin() + num_synced_positions, history.end());
+    num_synced_positions = history.size();
+}
+
+Board::FeaturePlaneRows IncrementalFeaturizer::assemble_rows() const {
+    const int own = color_index(to_play);
+    const int opp = 1 - own;
+
+    Board::FeaturePlaneRows result{};
+    for (int y = 0; y < Board::data_size; ++y) {
+        auto& row = result[y];
+        row[Board::legal_move_plane_index] = legal[own][y];
+        row[Board::on_board_plane_index] = on_board[y];
+        row[Board::own_stone_plane_index] = stones[own][y];
+        row[Board::opponent_stone_plane_index] = stones[opp][y];
+        row[Board::ko_plane_index] = ko[own][y];
+        for (int i = 0; i < Board::num_lib_planes; ++i) {
+            row[Board::lib_plane_index + i] = libs[own][i][y];
+            row[Board::lib_plane_index + Board::num_lib_planes + i] = libs[opp][i][y];
+        }
+        for (int i = 0; i < Board::num_lookahead_planes; ++i) {
+            row[Board::lookahead_plane_index + i] = lookahead[own][y][i] & legal[own][y];
+        }
+    }
+
+    const auto& history = board.history;
+    for (int dist = 0; dist < Board::num_history_planes && dist < history.size(); ++dist) {
+        const auto& history_move = history.rbegin()[dist];
+        if (!history_move.is_pass) {
+            result[history_move.coord.y + Board::padding][Board::history_plane_index + dist] |=
+                1u << (history_move.coord.x + Board::padding);
+        }
+    }
+    return result;
+}
+
+}  // namespace go_data_gen
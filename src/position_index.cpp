@@ -0,0 +1,276 @@
+#include "go_data_gen/position_index.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Distinguishes the indexes of one process in spill file names.
+std::atomic<uint64_t> next_instance_id{0};
+
+struct SpillEntry {
+    uint64_t hash;
+    uint32_t count;
+    uint32_t padding;
+};
+
+// Positions of the Bloom filter bits for `hash`, using double hashing.
+// The top bits select the shard, so only the lower bits are used here.
+template <typename Func>
+void for_each_bloom_bit(uint64_t hash, size_t num_bits, Func func) {
+    static constexpr int num_probes = 4;
+    const uint64_t h1 = hash & 0xffffffffULL;
+    const uint64_t h2 = ((hash >> 26) & 0xffffffffULL) | 1;
+    for (int i = 0; i < num_probes; ++i) {
+        func((h1 + i * h2) % num_bits);
+    }
+}
+
+void add_to_bloom(std::vector<uint64_t>& bloom, uint64_t hash) {
+    for_each_bloom_bit(hash, bloom.size() * 64,
+                       [&](size_t bit) { bloom[bit / 64] |= uint64_t{1} << (bit % 64); });
+}
+
+std::ofstream open_spill_output(const std::string& path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Could not open the spill file: " + path);
+    }
+    return out;
+}
+
+std::ifstream open_spill_input(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        throw std::runtime_error("Could not reopen the spill file: " + path);
+    }
+    return in;
+}
+
+}  // namespace
+
+namespace go_data_gen {
+
+PositionIndex::PositionIndex(size_t max_entries, const std::string& _spill_dir)
+    : max_entries_per_shard{std::max<size_t>(1, max_entries / num_shards)},
+      spill_dir{_spill_dir},
+      instance_id{next_instance_id++} {}
+
+PositionIndex::~PositionIndex() { clear(); }
+
+uint32_t PositionIndex::insert(uint64_t hash) {
+    const int shard_idx = shard_index(hash);
+    Shard& shard = shards[shard_idx];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.counts.find(hash);
+    if (it != shard.counts.end()) {
+        return it->second++ + count_spilled(shard, hash);
+    }
+    const uint32_t previous = count_spilled(shard, hash);
+    if (shard.counts.size() >= max_entries_per_shard) {
+        spill(shard, shard_idx);
+    }
+    shard.counts.emplace(hash, 1);
+    return previous;
+}
+
+uint32_t PositionIndex::count(uint64_t hash) const {
+    const Shard& shard = shards[shard_index(hash)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.counts.find(hash);
+    const uint32_t in_memory = it != shard.counts.end() ? it->second : 0;
+    return in_memory + count_spilled(shard, hash);
+}
+
+size_t PositionIndex::size() const {
+    size_t result = 0;
+    for (const Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        result += shard.counts.size();
+    }
+    return result;
+}
+
+size_t PositionIndex::num_spilled() const {
+    size_t result = 0;
+    for (const Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& run : shard.runs) {
+            result += run->num_entries;
+        }
+    }
+    return result;
+}
+
+void PositionIndex::clear() {
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.counts.clear();
+        for (auto& run : shard.runs) {
+            remove_run(*run);
+        }
+        shard.runs.clear();
+    }
+}
+
+uint32_t PositionIndex::count_spilled(const Shard& shard, uint64_t hash) const {
+    uint32_t result = 0;
+    for (const auto& run : shard.runs) {
+        bool maybe_present = true;
+        for_each_bloom_bit(hash, run->bloom.size() * 64, [&](size_t bit) {
+            maybe_present &= static_cast<bool>((run->bloom[bit / 64] >> (bit % 64)) & 1);
+        });
+        if (!maybe_present) {
+            continue;
+        }
+
+        // Binary search in the sorted run file. Keeping runs open would run out of file
+        // descriptors for long runs.
+        std::ifstream file = open_spill_input(run->path);
+        size_t lo = 0;
+        size_t hi = run->num_entries;
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            SpillEntry entry;
+            file.seekg(mid * sizeof(SpillEntry));
+            file.read(reinterpret_cast<char*>(&entry), sizeof(SpillEntry));
+            if (entry.hash == hash) {
+                result += entry.count;
+                break;
+            }
+            if (entry.hash < hash) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+    }
+    return result;
+}
+
+void PositionIndex::spill(Shard& shard, int shard_idx) {
+    if (spill_dir.empty()) {
+        shard.counts.clear();
+        return;
+    }
+
+    std::vector<SpillEntry> entries;
+    entries.reserve(shard.counts.size());
+    for (const auto& [hash, count] : shard.counts) {
+        entries.push_back(SpillEntry{hash, count, 0});
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const SpillEntry& a, const SpillEntry& b) { return a.hash < b.hash; });
+
+    auto run = new_run(shard, shard_idx, entries.size());
+    run->num_entries = entries.size();
+    std::ofstream out = open_spill_output(run->path);
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(SpillEntry));
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Could not write the spill file: " + run->path);
+    }
+    for (const SpillEntry& entry : entries) {
+        add_to_bloom(run->bloom, entry.hash);
+    }
+    shard.runs.push_back(std::move(run));
+    shard.counts.clear();
+
+    if (shard.runs.size() >= max_runs_per_shard) {
+        merge_runs(shard, shard_idx);
+    }
+}
+
+void PositionIndex::remove_run(const SpillRun& run) {
+    // Runs inherited from a parent process are still in use by the parent.
+    if (run.pid == ::getpid()) {
+        std::remove(run.path.c_str());
+    }
+}
+
+std::unique_ptr<PositionIndex::SpillRun> PositionIndex::new_run(Shard& shard, int shard_idx,
+                                                                size_t num_entries) const {
+    auto run = std::make_unique<SpillRun>();
+    // The process id is taken at spill time, so that processes forked from one parent, which share
+    // the index and its address, do not overwrite each other's runs.
+    char name[96];
+    std::snprintf(name, sizeof(name), "/position_index_%ld_%llu_%02d_%04d.bin",
+                  static_cast<long>(::getpid()), static_cast<unsigned long long>(instance_id),
+                  shard_idx, shard.num_runs_created++);
+    run->path = spill_dir + name;
+    run->pid = ::getpid();
+    run->bloom.assign((num_entries * bloom_bits_per_entry + 63) / 64, 0);
+    run->num_entries = 0;
+    return run;
+}
+
+void PositionIndex::merge_runs(Shard& shard, int shard_idx) {
+    // Streaming k-way merge that adds up the counts of hashes present in several runs, so lookups
+    // read at most max_runs_per_shard files.
+    size_t max_entries = 0;
+    std::vector<std::ifstream> inputs;
+    for (const auto& run : shard.runs) {
+        max_entries += run->num_entries;
+        inputs.push_back(open_spill_input(run->path));
+    }
+    auto merged = new_run(shard, shard_idx, max_entries);
+    std::ofstream out = open_spill_output(merged->path);
+
+    std::vector<SpillEntry> heads(inputs.size());
+    std::vector<size_t> num_read(inputs.size(), 0);
+    auto advance = [&](size_t i) {
+        if (num_read[i] == shard.runs[i]->num_entries) {
+            heads[i].hash = UINT64_MAX;
+            heads[i].count = 0;
+            return;
+        }
+        inputs[i].read(reinterpret_cast<char*>(&heads[i]), sizeof(SpillEntry));
+        if (!inputs[i]) {
+            throw std::runtime_error("Could not read the spill file: " + shard.runs[i]->path);
+        }
+        ++num_read[i];
+    };
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        advance(i);
+    }
+    // Exhausted runs hold UINT64_MAX with a count of 0, which ends the loop.
+    while (true) {
+        uint64_t hash = UINT64_MAX;
+        uint32_t count = 0;
+        for (const SpillEntry& head : heads) {
+            hash = std::min(hash, head.hash);
+        }
+        for (size_t i = 0; i < heads.size(); ++i) {
+            if (heads[i].hash == hash && heads[i].count > 0) {
+                count += heads[i].count;
+                advance(i);
+            }
+        }
+        if (count == 0) {
+            break;
+        }
+        const SpillEntry entry{hash, count, 0};
+        out.write(reinterpret_cast<const char*>(&entry), sizeof(SpillEntry));
+        add_to_bloom(merged->bloom, hash);
+        ++merged->num_entries;
+    }
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Could not write the spill file: " + merged->path);
+    }
+
+    for (auto& run : shard.runs) {
+        remove_run(*run);
+    }
+    shard.runs.clear();
+    shard.runs.push_back(std::move(merged));
+}
+
+}  // namespace go_data_gen
@@ -1,123 +1,384 @@
 #include "go_data_gen/sgf.hpp"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <regex>
 #include <sstream>
 
 #include "go_data_gen/board.hpp"
+#include "go_data_gen/file_reader.hpp"
+#include "go_data_gen/parallel.hpp"
+#include "go_data_gen/sgf_index.hpp"
 #include "go_data_gen/types.hpp"
 
 namespace go_data_gen {
 
-bool load_sgf(const std::string& file_path, Board& board, std::vector<Move>& moves, float& result) {
-    std::ifstream file(file_path);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open the file: " + file_path);
+namespace {
+
+// The first `start_turn_index` moves are not used for training, so they become part of the
+// starting position. Returns false if no moves remain.
+bool skip_start_moves(Board& board, const std::vector<Move>& setup_moves, std::vector<Move>& moves,
+                      int start_turn_index) {
+    // If the game only contains high-temperature moves, skip it.
+    if (moves.size() <= start_turn_index) {
+        return false;
     }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    const std::string content = buffer.str();
+    // Prepare board for training
+    board.reset();
+    for (const Move& move : setup_moves) {
+        board.setup_move(move);
+    }
+    for (int i = 0; i < start_turn_index; i++) {
+        board.play(moves[i]);
+    }
+    moves.erase(moves.begin(), moves.begin() + start_turn_index);
+    return true;
+}
 
-    // If the game began in an encore phase, skip it
-    const std::regex encore_regex(R"(beganInEncorePhase=(\d+))");
-    std::smatch encore_match;
-    if (std::regex_search(content, encore_match, encore_regex)) {
+// Score from Black's perspective of a result such as "B+3.5", "W+R", "0" or "Void".
+// Returns false if the result has another form.
+bool parse_result(std::string_view result_str, float& result) {
+    if (result_str == "B+R") {
+        result = 1000.0f;  // Black wins by resignation
+    } else if (result_str == "W+R") {
+        result = -1000.0f;  // White wins by resignation
+    } else if (result_str == "0" || result_str == "Void") {
+        result = 0.0f;  // Draw or void game
+    } else {
+        // Parse score for B+<score> or W+<score>
+        if (result_str.size() < 3 || (result_str[0] != 'B' && result_str[0] != 'W') ||
+            result_str[1] != '+') {
+            return false;
+        }
+        const std::string score_str(result_str.substr(2));
+        char* end;
+        const float score = std::strtof(score_str.c_str(), &end);
+        if (end != score_str.c_str() + score_str.size() || score_str[0] < '0' ||
+            score_str[0] > '9') {
+            return false;
+        }
+        result = (result_str[0] == 'W' ? -1.0f : 1.0f) * score;
+    }
+    return true;
+}
+
+// Coordinate of an SGF point such as "dd". Returns false for anything else, including passes.
+bool parse_point(std::string_view value, Vec2& coord) {
+    if (value.size() != 2 || value[0] < 'a' || value[0] > 'z' || value[1] < 'a' ||
+        value[1] > 'z') {
         return false;
     }
+    coord = {value[0] - 'a', value[1] - 'a'};
+    return true;
+}
 
-    // Extract size
-    const std::regex size_regex(R"(SZ\[(\d+)(?::(\d+))?\])");
-    std::smatch size_match;
-    const bool size_found = std::regex_search(content, size_match, size_regex);
-    assert(size_found && "Size not found in the SGF file");
-    const int size_x = std::stoi(size_match[1]);
-    const int size_y =
-        size_match.size() > 2 && size_match[2].matched ? std::stoi(size_match[2]) : size_x;
-    assert(size_x <= Board::max_board_size && size_y <= Board::max_board_size &&
-           "Maximum size exceeded");
+// Converts the status of a try_load function to the return value of the throwing variants.
+bool check_status(SgfStatus status, const std::string& reason) {
+    if (status == SgfStatus::Ok) {
+        return true;
+    }
+    if (status == SgfStatus::Skipped) {
+        return false;
+    }
+    throw std::runtime_error(reason);
+}
 
-    // Extract number of handicap stones
-    const std::regex handicap_regex(R"(HA\[(\d+)\])");
-    std::smatch handicap_match;
-    const bool handicap_found = std::regex_search(content, handicap_match, handicap_regex);
-    const int num_handicap_stones = handicap_found ? std::stoi(handicap_match[1]) : 0;
+// Decides from a complete root node whether to load the game.
+SgfStatus check_root(const SgfMetadata& metadata, const SgfFilter& filter, std::string& reason) {
+    if (!metadata.is_valid) {
+        reason = "Missing SZ property";
+        return SgfStatus::InvalidProperty;
+    }
+    if (metadata.began_in_encore) {
+        reason = "Began in the encore phase";
+        return SgfStatus::Skipped;
+    }
+    if (filter && !filter(metadata)) {
+        reason = "Rejected by the filter";
+        return SgfStatus::Skipped;
+    }
+    // load_sgf requires it too. Defaulting to 0 would train on the high-temperature opening.
+    if (metadata.start_turn_index < 0) {
+        reason = "Missing startTurnIdx";
+        return SgfStatus::InvalidProperty;
+    }
+    return SgfStatus::Ok;
+}
 
-    // Extract komi
-    const std::regex komi_regex(R"(KM\[(-?\d+(?:\.\d+)?)\])");
-    std::smatch komi_match;
-    const bool komi_found = std::regex_search(content, komi_match, komi_regex);
-    assert(komi_found && "Komi not found in the SGF file");
-    const double komi = std::stod(komi_match[1]);
+// Checks the root properties that loading needs and replays the game like load_sgf_from_buffer:
+// all setup stones are placed first, and moves stop after two consecutive passes. Unlike
+// load_sgf_from_buffer, moves of the same color in a row are rejected instead of asserted.
+SgfStatus replay_game(std::string_view content, const SgfMetadata& metadata, Board& board,
+                      std::vector<Move>& setup_moves, std::vector<Move>& moves, float& result,
+                      std::string& reason) {
+    const Vec2 board_size = metadata.board_size;
+    if (board_size.x < 1 || board_size.y < 1 || board_size.x > Board::max_board_size ||
+        board_size.y > Board::max_board_size) {
+        reason = "Invalid SZ property";
+        return SgfStatus::InvalidProperty;
+    }
+    if (metadata.rules.empty()) {
+        reason = "Missing RU property";
+        return SgfStatus::InvalidProperty;
+    }
+    if (!parse_result(metadata.result, result)) {
+        reason = metadata.result.empty() ? "Missing RE property" : "Invalid RE property";
+        return SgfStatus::InvalidProperty;
+    }
 
-    // Extract ruleset
-    const std::regex ruleset_regex(R"(RU\[([^\]]+)\])");
-    std::smatch ruleset_match;
-    const bool ruleset_found = std::regex_search(content, ruleset_match, ruleset_regex);
-    assert(ruleset_found && "Ruleset not found in the SGF file");
+    bool komi_found = false;
+    bool coords_valid = true;
+    int consecutive_passes = 0;
+    auto on_board = [&](Vec2 coord) { return coord.x < board_size.x && coord.y < board_size.y; };
+    const size_t end = for_each_sgf_property(content, 0, [&](int node_index, std::string_view id,
+                                                             std::string_view value) {
+        Vec2 coord;
+        if (node_index == 0 && id == "KM") {
+            komi_found = true;
+        } else if (id.size() == 2 && id[0] == 'A' &&
+                   (id[1] == 'B' || id[1] == 'W' || id[1] == 'E')) {
+            if (parse_point(value, coord)) {
+                const Color color = id[1] == 'B' ? Black : id[1] == 'W' ? White : Empty;
+                coords_valid = coords_valid && on_board(coord);
+                setup_moves.push_back(Move{color, false, coord});
+            }
+        } else if (id == "B" || id == "W") {
+            const Color color = id == "B" ? Black : White;
+            if (value.empty()) {
+                moves.push_back(Move{color, true, {0, 0}});
+                ++consecutive_passes;
+            } else if (parse_point(value, coord)) {
+                coords_valid = coords_valid && on_board(coord);
+                moves.push_back(Move{color, false, coord});
+                consecutive_passes = 0;
+            }
+        }
+        return consecutive_passes < 2;
+    });
+    if (end == std::string_view::npos) {
+        reason = "Incomplete game tree";
+        return SgfStatus::InvalidProperty;
+    }
+    if (!komi_found) {
+        reason = "Missing KM property";
+        return SgfStatus::InvalidProperty;
+    }
+    if (!coords_valid) {
+        reason = "Point outside of the board";
+        return SgfStatus::IllegalMove;
+    }
+
+    board.reset(board_size, metadata.komi, parse_ruleset(metadata.rules),
+                metadata.num_handicap_stones);
+    for (const Move& move : setup_moves) {
+        board.setup_move(move);
+    }
+    for (size_t i = 0; i < moves.size(); ++i) {
+        const Move& move = moves[i];
+        if ((i > 0 && move.color == moves[i - 1].color) ||
+            board.get_move_legality(move) != MoveLegality::Legal) {
+            reason = "Illegal move " + std::to_string(i);
+            return SgfStatus::IllegalMove;
+        }
+        board.play(move);
+    }
+    return SgfStatus::Ok;
+}
 
-    const std::string rules_str = ruleset_match[1];
+// Resets `metadata` for scan_sgf_root while keeping the storage of its strings.
+void reset_metadata(SgfMetadata& metadata) {
+    std::string rules = std::move(metadata.rules);
+    std::string result = std::move(metadata.result);
+    metadata = SgfMetadata{};
+    rules.clear();
+    result.clear();
+    metadata.rules = std::move(rules);
+    metadata.result = std::move(result);
+}
+
+// Implements try_load_sgf_from_buffer with caller-provided buffers, which are overwritten. Moves
+// are appended to `moves`.
+SgfStatus load_game(std::string_view content, const SgfFilter& filter, SgfMetadata& metadata,
+                    Board& board, std::vector<Move>& setup_moves, std::vector<Move>& moves,
+                    float& result, std::string& reason) {
+    reason.clear();
+    reset_metadata(metadata);
+    if (!scan_sgf_root(content, metadata)) {
+        reason = "Incomplete game tree";
+        return SgfStatus::InvalidProperty;
+    }
+    if (const SgfStatus status = check_root(metadata, filter, reason); status != SgfStatus::Ok) {
+        return status;
+    }
+    setup_moves.clear();
+    if (const SgfStatus status =
+            replay_game(content, metadata, board, setup_moves, moves, result, reason);
+        status != SgfStatus::Ok) {
+        return status;
+    }
+    if (!skip_start_moves(board, setup_moves, moves, metadata.start_turn_index)) {
+        reason = "No moves after the start turn";
+        return SgfStatus::Skipped;
+    }
+    return SgfStatus::Ok;
+}
+
+// Reads up to `size` bytes at `offset`. Returns the number of bytes read, or -1 on error.
+ssize_t read_at(int fd, char* data, size_t size, off_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t n = ::pread(fd, data + done, size - done, offset + done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+}  // namespace
+
+Ruleset parse_ruleset(std::string_view rules_str) {
     Ruleset ruleset;
 
     // Parse ko rule
-    if (rules_str.find("koPOSITIONAL") != std::string::npos) {
+    if (rules_str.find("koPOSITIONAL") != std::string_view::npos) {
         ruleset.ko_rule = KoRule::PositionalSuperko;
-    } else if (rules_str.find("koSITUATIONAL") != std::string::npos) {
+    } else if (rules_str.find("koSITUATIONAL") != std::string_view::npos) {
         ruleset.ko_rule = KoRule::SituationalSuperko;
     } else {
         ruleset.ko_rule = KoRule::Simple;
     }
 
     // Parse suicide rule
-    if (rules_str.find("sui1") != std::string::npos) {
+    if (rules_str.find("sui1") != std::string_view::npos) {
         ruleset.suicide_rule = SuicideRule::Allowed;
     } else {
         ruleset.suicide_rule = SuicideRule::Disallowed;
     }
 
     // Parse scoring rule
-    if (rules_str.find("scoreAREA") != std::string::npos) {
+    if (rules_str.find("scoreAREA") != std::string_view::npos) {
         ruleset.scoring_rule = ScoringRule::Area;
     } else {
         ruleset.scoring_rule = ScoringRule::Territory;
     }
 
     // Parse tax rule
-    if (rules_str.find("taxALL") != std::string::npos) {
+    if (rules_str.find("taxALL") != std::string_view::npos) {
         ruleset.tax_rule = TaxRule::All;
-    } else if (rules_str.find("taxSEKI") != std::string::npos) {
+    } else if (rules_str.find("taxSEKI") != std::string_view::npos) {
         ruleset.tax_rule = TaxRule::Seki;
     } else {
         ruleset.tax_rule = TaxRule::NoTax;
     }
 
     // Parse button (first player pass bonus) rule
-    if (rules_str.find("button1") != std::string::npos) {
+    if (rules_str.find("button1") != std::string_view::npos) {
         ruleset.first_player_pass_bonus_rule = FirstPlayerPassBonusRule::Bonus;
     } else {
         ruleset.first_player_pass_bonus_rule = FirstPlayerPassBonusRule::NoBonus;
     }
 
+    return ruleset;
+}
+
+bool load_sgf(const std::string& file_path, Board& board, std::vector<Move>& moves, float& result) {
+    std::ifstream file(file_path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open the file: " + file_path);
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return load_sgf_from_buffer(buffer.str(), board, moves, result);
+}
+
+bool load_sgf_from_buffer(std::string_view content, Board& board, std::vector<Move>& moves,
+                          float& result) {
+    const char* const content_begin = content.data();
+    const char* const content_end = content.data() + content.size();
+
+    // If the game began in an encore phase, skip it
+    const std::regex encore_regex(R"(beganInEncorePhase=(\d+))");
+    std::cmatch encore_match;
+    if (std::regex_search(content_begin, content_end, encore_match, encore_regex)) {
+        return false;
+    }
+
+    // Extract size
+    const std::regex size_regex(R"(SZ\[(\d+)(?::(\d+))?\])");
+    std::cmatch size_match;
+    if (!std::regex_search(content_begin, content_end, size_match, size_regex)) {
+        throw std::runtime_error("Size not found in the SGF file");
+    }
+    const int size_x = std::stoi(size_match[1]);
+    const int size_y =
+        size_match.size() > 2 && size_match[2].matched ? std::stoi(size_match[2]) : size_x;
+    if (size_x < 1 || size_y < 1 || size_x > Board::max_board_size ||
+        size_y > Board::max_board_size) {
+        throw std::runtime_error("Invalid size in the SGF file");
+    }
+
+    // Extract number of handicap stones
+    const std::regex handicap_regex(R"(HA\[(\d+)\])");
+    std::cmatch handicap_match;
+    const bool handicap_found =
+        std::regex_search(content_begin, content_end, handicap_match, handicap_regex);
+    const int num_handicap_stones = handicap_found ? std::stoi(handicap_match[1]) : 0;
+
+    // Extract komi
+    const std::regex komi_regex(R"(KM\[(-?\d+(?:\.\d+)?)\])");
+    std::cmatch komi_match;
+    if (!std::regex_search(content_begin, content_end, komi_match, komi_regex)) {
+        throw std::runtime_error("Komi not found in the SGF file");
+    }
+    const double komi = std::stod(komi_match[1]);
+
+    // Extract ruleset
+    const std::regex ruleset_regex(R"(RU\[([^\]]+)\])");
+    std::cmatch ruleset_match;
+    if (!std::regex_search(content_begin, content_end, ruleset_match, ruleset_regex)) {
+        throw std::runtime_error("Ruleset not found in the SGF file");
+    }
+
+    const Ruleset ruleset = parse_ruleset(ruleset_match[1].str());
+
     // Set up board and verify that all moves are legal
     board = Board(Vec2{size_x, size_y}, komi, ruleset, num_handicap_stones);
 
-    const std::sregex_iterator end;
+    const std::cregex_iterator end;
 
     // Handle setup and handicap moves
     std::vector<Move> setup_moves;
     const std::regex setup_regex(R"(A([BWE])(\[[a-z]{2}\])+)");
-    std::sregex_iterator setup_iter(content.begin(), content.end(), setup_regex);
+    std::cregex_iterator setup_iter(content_begin, content_end, setup_regex);
     const std::regex coord_regex(R"(\[([a-z]{2})\])");
     while (setup_iter != end) {
-        const std::smatch setup_match = *setup_iter;
+        const std::cmatch setup_match = *setup_iter;
         const char setup_type = setup_match[1].str()[0];
-        const std::string coords_str = setup_match[0].str();
-
-        std::sregex_iterator coord_iter(coords_str.begin(), coords_str.end(), coord_regex);
+        std::cregex_iterator coord_iter(setup_match[0].first, setup_match[0].second, coord_regex);
 
         while (coord_iter != end) {
-            const std::smatch coord_match = *coord_iter;
+            const std::cmatch coord_match = *coord_iter;
             const int x = static_cast<int>(coord_match[1].str()[0] - 'a');
             const int y = static_cast<int>(coord_match[1].str()[1] - 'a');
 
@@ -143,14 +404,14 @@ bool load_sgf(const std::string& file_path, Board& board, std::vector<Move>& mov
     // Doesn't handle branches!!
     // Stop extraction after two consecutive passes
     const std::regex move_regex(R"(([BW])\[([a-z]{2})?\])");
-    std::sregex_iterator move_iter(content.begin(), content.end(), move_regex);
+    std::cregex_iterator move_iter(content_begin, content_end, move_regex);
     int consecutive_passes = 0;
     while (move_iter != end && consecutive_passes < 2) {
-        const std::smatch move_match = *move_iter;
+        const std::cmatch move_match = *move_iter;
 
         // Explictly need to skip false AB and AW matches since C++ regex doesn't support negative
         // lookbehind assertions
-        std::string move_context;
+        std::string_view move_context;
         if (move_match.position() >= 1) {
             move_context = content.substr(move_match.position() - 1, 2);
         } else {
@@ -206,51 +467,280 @@ bool load_sgf(const std::string& file_path, Board& board, std::vector<Move>& mov
 
     // Extract start turn index
     const std::regex start_turn_regex(R"(startTurnIdx=(\d+))");
-    std::smatch start_turn_match;
-    const bool start_turn_found = std::regex_search(content, start_turn_match, start_turn_regex);
-    assert(start_turn_found && "Start turn not found in the SGF file");
+    std::cmatch start_turn_match;
+    if (!std::regex_search(content_begin, content_end, start_turn_match, start_turn_regex)) {
+        throw std::runtime_error("Start turn not found in the SGF file");
+    }
     const int start_turn_index = std::stoi(start_turn_match[1]);
 
-    // If the game only contains high-temperature moves, skip it.
-    if (moves.size() <= start_turn_index) {
+    if (!skip_start_moves(board, setup_moves, moves, start_turn_index)) {
         return false;
     }
 
-    // Prepare board for training
-    board.reset();
-    for (const Move& move : setup_moves) {
-        board.setup_move(move);
+    // Extract result
+    const std::regex result_regex(R"(RE\[((?:B|W)\+(?:\d+(?:\.\d+)?|R)?|0|Void)\])");
+    std::cmatch result_match;
+    if (!std::regex_search(content_begin, content_end, result_match, result_regex) ||
+        !parse_result(result_match[1].str(), result)) {
+        throw std::runtime_error("Result not found in the SGF file");
     }
-    // Treat the first startTurnIdx moves as setup moves that should not be included in the training
-    // data.
-    for (int i = 0; i < start_turn_index; i++) {
-        board.play(moves[i]);
+
+    return true;
+}
+
+bool load_sgf_filtered(const std::string& file_path, const SgfFilter& filter, Board& board,
+                       std::vector<Move>& moves, float& result) {
+    std::string reason;
+    return check_status(try_load_sgf(file_path, filter, board, moves, result, reason), reason);
+}
+
+bool load_sgf_from_buffer_filtered(std::string_view content, const SgfFilter& filter, Board& board,
+                                   std::vector<Move>& moves, float& result) {
+    std::string reason;
+    return check_status(try_load_sgf_from_buffer(content, filter, board, moves, result, reason),
+                        reason);
+}
+
+SgfStatus try_load_sgf(const std::string& file_path, const SgfFilter& filter, Board& board,
+                       std::vector<Move>& moves, float& result, std::string& reason) {
+    reason.clear();
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+        reason = "Could not open the file";
+        return SgfStatus::ReadError;
     }
-    assert(moves.size() > start_turn_index && "Not enough moves to train");
-    moves.erase(moves.begin(), moves.begin() + start_turn_index);
-    assert(moves.size() > 0 && "No moves left to train");
 
-    // Extract result
-    const std::regex result_regex(R"(RE\[((?:B|W)\+(?:\d+(?:\.\d+)?|R)?|0|Void)\])");
-    std::smatch result_match;
-    const bool result_found = std::regex_search(content, result_match, result_regex);
-    assert(result_found && "Result not found in the SGF file");
+    // Root nodes are usually a few hundred bytes, so rejected files are decided by the first read.
+    constexpr size_t prefix_size = 4096;
+    std::string content(prefix_size, '\0');
+    file.read(content.data(), prefix_size);
+    content.resize(file.gcount());
+    SgfMetadata metadata;
+    if (file && scan_sgf_root(content, metadata) &&
+        check_root(metadata, filter, reason) == SgfStatus::Skipped) {
+        return SgfStatus::Skipped;
+    }
+    if (file) {
+        content.append(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    if (file.bad()) {
+        reason = "Could not read the file";
+        return SgfStatus::ReadError;
+    }
+    return try_load_sgf_from_buffer(content, filter, board, moves, result, reason);
+}
 
-    const std::string result_str = result_match[1].str();
-    if (result_str == "B+R") {
-        result = 1000.0f;  // Black wins by resignation
-    } else if (result_str == "W+R") {
-        result = -1000.0f;  // White wins by resignation
-    } else if (result_str == "0" || result_str == "Void") {
-        result = 0.0f;  // Draw or void game
-    } else {
-        // Parse score for B+<score> or W+<score>
-        const char winner = result_str[0];
-        const float score = std::stof(result_str.substr(2));
-        result = (winner == 'W' ? -1.0f : 1.0f) * score;
+SgfStatus try_load_sgf_from_buffer(std::string_view content, const SgfFilter& filter, Board& board,
+                                   std::vector<Move>& moves, float& result, std::string& reason) {
+    SgfMetadata metadata;
+    std::vector<Move> setup_moves;
+    return load_game(content, filter, metadata, board, setup_moves, moves, result, reason);
+}
+
+SgfStatus GameLoader::load(const std::string& file_path, const SgfFilter& filter) {
+    reason.clear();
+    const int fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        reason = "Could not open the file";
+        return SgfStatus::ReadError;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        reason = "Could not read the file";
+        return SgfStatus::ReadError;
     }
 
-    return true;
+    // Like try_load_sgf, decide rejected files by the root node in the first few KB.
+    constexpr size_t prefix_size = 4096;
+    const size_t size = st.st_size;
+    buffer.resize(size);
+    ssize_t num_read = read_at(fd, buffer.data(), std::min(size, prefix_size), 0);
+    if (num_read == static_cast<ssize_t>(prefix_size) && size > prefix_size) {
+        reset_metadata(metadata);
+        if (scan_sgf_root(std::string_view(buffer.data(), prefix_size), metadata) &&
+            check_root(metadata, filter, reason) == SgfStatus::Skipped) {
+            ::close(fd);
+            return SgfStatus::Skipped;
+        }
+        const ssize_t num_rest =
+            read_at(fd, buffer.data() + prefix_size, size - prefix_size, prefix_size);
+        num_read = num_rest < 0 ? -1 : num_read + num_rest;
+    }
+    ::close(fd);
+    if (num_read < 0) {
+        reason = "Could not read the file";
+        return SgfStatus::ReadError;
+    }
+    buffer.resize(num_read);
+    return load_from_buffer(buffer, filter);
+}
+
+SgfStatus GameLoader::load_from_buffer(std::string_view content, const SgfFilter& filter) {
+    moves.clear();
+    return load_game(content, filter, metadata, board, setup_moves, moves, result, reason);
+}
+
+size_t GameLoader::get_peak_memory_usage() const {
+    return sizeof(GameLoader) - sizeof(Board) + board.get_memory_usage() + buffer.capacity() +
+           metadata.rules.capacity() + metadata.result.capacity() + reason.capacity() +
+           (setup_moves.capacity() + moves.capacity()) * sizeof(Move);
+}
+
+std::vector<SgfLoadResult> load_sgf_many(const std::vector<std::string>& paths,
+                                         const SgfFilter& filter, int num_threads) {
+    std::vector<SgfLoadResult> results(paths.size());
+    // Like GameLoader::load, rejected files are decided by their root node, without reading them
+    // to the end. A rejected prefix gives the same status and reason when it is parsed below.
+    auto read_rest = [&filter](std::string_view prefix) {
+        SgfMetadata metadata;
+        std::string reason;
+        return !scan_sgf_root(prefix, metadata) ||
+               check_root(metadata, filter, reason) != SgfStatus::Skipped;
+    };
+    // Files are read in the background while the threads parse the ones that are ready. A few
+    // reads in flight per parser keep them busy; the threads backend uses one thread per read.
+    const int num_parsers = resolve_num_threads(num_threads);
+    const int queue_depth = std::min(64, 2 * num_parsers);
+    FileReader reader(paths, queue_depth, 4 * queue_depth, IoBackend::Auto, read_rest);
+    parallel_for(num_parsers, num_parsers, [&](size_t) {
+        FileReader::File file;
+        GameLoader loader;
+        while (reader.next(file)) {
+            SgfLoadResult& entry = results[file.index];
+            if (file.error != 0) {
+                // std::strerror is not thread-safe.
+                entry.status = SgfStatus::ReadError;
+                entry.reason = file.error == ENOENT ? "Could not open the file"
+                                                    : "Could not read the file";
+                continue;
+            }
+            entry.status = loader.load_from_buffer(file.content, filter);
+            entry.reason = loader.get_reason();
+            if (entry.status == SgfStatus::Ok) {
+                entry.board = loader.get_board().serialize();
+                entry.result = loader.get_result();
+                entry.moves.reserve(loader.get_moves().size());
+                for (const Move& move : loader.get_moves()) {
+                    entry.moves.push_back(PackedMove::from_move(move));
+                }
+            }
+        }
+    });
+    return results;
+}
+
+SgfStatus compact_sgf(std::string_view content, std::string& output, std::string& reason) {
+    reason.clear();
+    SgfMetadata metadata;
+    if (!scan_sgf_root(content, metadata)) {
+        reason = "Incomplete game tree";
+        return SgfStatus::InvalidProperty;
+    }
+    if (!metadata.is_valid) {
+        reason = "Missing SZ property";
+        return SgfStatus::InvalidProperty;
+    }
+    // Writing a default would make a game that load_sgf rejects loadable.
+    if (metadata.start_turn_index < 0) {
+        reason = "Missing startTurnIdx";
+        return SgfStatus::InvalidProperty;
+    }
+    Board board;
+    std::vector<Move> setup_moves;
+    std::vector<Move> moves;
+    float result;
+    if (const SgfStatus status =
+            replay_game(content, metadata, board, setup_moves, moves, result, reason);
+        status != SgfStatus::Ok) {
+        return status;
+    }
+
+    // Setup stones do not capture, so only the final stone of each point matters.
+    Color setup_stones[Board::max_board_size][Board::max_board_size] = {};
+    for (const Move& move : setup_moves) {
+        setup_stones[move.coord.y][move.coord.x] = move.color;
+    }
+    auto append_point = [&](Vec2 coord) {
+        output += '[';
+        output += static_cast<char>('a' + coord.x);
+        output += static_cast<char>('a' + coord.y);
+        output += ']';
+    };
+
+    const Vec2 board_size = metadata.board_size;
+    char komi[32];
+    std::snprintf(komi, sizeof(komi), "%g", metadata.komi);
+    output.clear();
+    output += "(;FF[4]GM[1]SZ[" + std::to_string(board_size.x);
+    if (board_size.y != board_size.x) {
+        output += ':' + std::to_string(board_size.y);
+    }
+    output += "]HA[" + std::to_string(metadata.num_handicap_stones) + "]KM[" + komi + "]RU[" +
+              metadata.rules + "]RE[" + metadata.result + "]C[startTurnIdx=" +
+              std::to_string(metadata.start_turn_index);
+    if (metadata.began_in_encore) {
+        output += ",beganInEncorePhase=1";
+    }
+    output += ']';
+    for (const Color color : {Black, White}) {
+        bool has_stones = false;
+        for (int y = 0; y < board_size.y; ++y) {
+            for (int x = 0; x < board_size.x; ++x) {
+                if (setup_stones[y][x] == color) {
+                    output += has_stones ? "" : color == Black ? "AB" : "AW";
+                    has_stones = true;
+                    append_point({x, y});
+                }
+            }
+        }
+    }
+    for (const Move& move : moves) {
+        output += move.color == Black ? ";B" : ";W";
+        if (move.is_pass) {
+            output += "[]";
+        } else {
+            append_point(move.coord);
+        }
+    }
+    output += ")\n";
+    return SgfStatus::Ok;
+}
+
+std::vector<SgfCompactResult> compact_sgf_files(const std::vector<std::string>& inputs,
+                                                const std::string& input_root,
+                                                const std::string& output_dir, int num_threads) {
+    std::vector<SgfCompactResult> results(inputs.size());
+    parallel_for(inputs.size(), num_threads, [&](size_t i) {
+        SgfCompactResult& entry = results[i];
+        const std::filesystem::path input_path = std::filesystem::path(input_root) / inputs[i];
+        std::ifstream file(input_path, std::ios::binary);
+        std::string content{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+        if (!file.is_open() || file.bad()) {
+            entry.status = SgfStatus::ReadError;
+            entry.reason = "Could not read the file";
+            return;
+        }
+        entry.input_bytes = content.size();
+
+        std::string output;
+        entry.status = compact_sgf(content, output, entry.reason);
+        if (entry.status != SgfStatus::Ok) {
+            return;
+        }
+        const std::filesystem::path output_path = std::filesystem::path(output_dir) / inputs[i];
+        std::error_code error;
+        std::filesystem::create_directories(output_path.parent_path(), error);
+        std::ofstream out(output_path, std::ios::binary | std::ios::trunc);
+        out.write(output.data(), output.size());
+        if (!out) {
+            entry.status = SgfStatus::ReadError;
+            entry.reason = "Could not write the file: " + output_path.string();
+            return;
+        }
+        entry.output_bytes = output.size();
+    });
+    return results;
 }
 
 }  // namespace go_data_gen
@@ -0,0 +1,305 @@
+#include "go_data_gen/sgf_index.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include "go_data_gen/parallel.hpp"
+#include "go_data_gen/sgf.hpp"
+
+namespace {
+
+constexpr char index_magic[8] = {'G', 'D', 'G', 'S', 'G', 'F', 'I', 'X'};
+constexpr uint32_t index_version = 2;
+// Size of an entry with empty strings: path, offset, length, size, komi, handicap, rules, result,
+// start turn, number of moves and flags.
+constexpr uint64_t min_entry_size = 2 + 8 + 8 + 2 + 4 + 2 + 1 + 1 + 4 + 4 + 1;
+
+// Parses the leading integer of `value`, returning `fallback` if there is none.
+int parse_int(std::string_view value, int fallback) {
+    size_t pos = 0;
+    bool negative = false;
+    if (pos < value.size() && value[pos] == '-') {
+        negative = true;
+        ++pos;
+    }
+    if (pos >= value.size() || value[pos] < '0' || value[pos] > '9') {
+        return fallback;
+    }
+    int result = 0;
+    while (pos < value.size() && value[pos] >= '0' && value[pos] <= '9') {
+        result = result * 10 + (value[pos] - '0');
+        ++pos;
+    }
+    return negative ? -result : result;
+}
+
+// Parses "key=<int>" inside a comment such as "startTurnIdx=12,initTurnNum=0". The value is -1 if
+// the key is not followed by a number.
+bool find_comment_int(std::string_view comment, std::string_view key, int& value) {
+    const size_t pos = comment.find(key);
+    if (pos == std::string_view::npos) {
+        return false;
+    }
+    value = parse_int(comment.substr(pos + key.size()), -1);
+    return true;
+}
+
+// Reads one property of a root node into `metadata`.
+void read_root_property(std::string_view id, std::string_view value,
+                        go_data_gen::SgfMetadata& metadata, bool& size_found) {
+    if (id == "SZ") {
+        size_found = true;
+        metadata.board_size.x = parse_int(value, 0);
+        const size_t colon = value.find(':');
+        metadata.board_size.y = colon != std::string_view::npos
+                                    ? parse_int(value.substr(colon + 1), metadata.board_size.x)
+                                    : metadata.board_size.x;
+    } else if (id == "KM") {
+        metadata.komi = std::strtof(std::string(value).c_str(), nullptr);
+    } else if (id == "HA") {
+        metadata.num_handicap_stones = parse_int(value, 0);
+    } else if (id == "RU") {
+        metadata.rules = value;
+    } else if (id == "RE") {
+        metadata.result = value;
+    }
+}
+
+// The start turn and encore flag are stored in comments.
+void read_comment(std::string_view comment, go_data_gen::SgfMetadata& metadata) {
+    int began_in_encore = 0;
+    if (find_comment_int(comment, "beganInEncorePhase=", began_in_encore)) {
+        metadata.began_in_encore = true;
+    }
+    int start_turn_index;
+    if (find_comment_int(comment, "startTurnIdx=", start_turn_index) && start_turn_index >= 0) {
+        metadata.start_turn_index = start_turn_index;
+    }
+}
+
+template <typename T>
+void write_pod(std::ofstream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T read_pod(std::ifstream& in) {
+    T value{};
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return value;
+}
+
+template <typename Length>
+void write_string(std::ofstream& out, const std::string& str) {
+    const auto length =
+        static_cast<Length>(std::min<size_t>(str.size(), std::numeric_limits<Length>::max()));
+    write_pod(out, length);
+    out.write(str.data(), length);
+}
+
+template <typename Length>
+std::string read_string(std::ifstream& in) {
+    std::string str(read_pod<Length>(in), '\0');
+    in.read(str.data(), str.size());
+    return str;
+}
+
+}  // namespace
+
+namespace go_data_gen {
+
+void scan_sgf_metadata(std::string_view content, const std::string& path,
+                       std::vector<SgfMetadata>& entries) {
+    size_t pos = 0;
+    while ((pos = content.find('(', pos)) != std::string_view::npos) {
+        SgfMetadata metadata;
+        metadata.path = path;
+        metadata.offset = pos;
+
+        bool size_found = false;
+        const size_t end = for_each_sgf_property(
+            content, pos, [&](int node_index, std::string_view id, std::string_view value) {
+                if (node_index == 0) {
+                    read_root_property(id, value, metadata, size_found);
+                } else if (id == "B" || id == "W") {
+                    ++metadata.num_moves;
+                }
+                if (id == "C") {
+                    read_comment(value, metadata);
+                }
+                return true;
+            });
+
+        metadata.is_valid = end != std::string_view::npos && size_found;
+        metadata.length = (end != std::string_view::npos ? end : content.size()) - pos;
+        entries.push_back(std::move(metadata));
+        if (end == std::string_view::npos) {
+            break;
+        }
+        pos = end;
+    }
+}
+
+bool scan_sgf_root(std::string_view content, SgfMetadata& metadata) {
+    bool size_found = false;
+    bool is_complete = false;
+    const size_t end = for_each_sgf_property(
+        content, 0, [&](int node_index, std::string_view id, std::string_view value) {
+            if (node_index > 0) {
+                is_complete = true;
+                return false;
+            }
+            read_root_property(id, value, metadata, size_found);
+            if (id == "C") {
+                read_comment(value, metadata);
+            }
+            return true;
+        });
+    // Games that consist of only the root node are complete as well.
+    is_complete = is_complete || end != std::string_view::npos;
+    metadata.is_valid = is_complete && size_found;
+    return is_complete;
+}
+
+std::vector<SgfMetadata> scan_sgf_files(const std::vector<std::string>& paths, int num_threads) {
+    // Each file is scanned into its own slot so the output order is deterministic.
+    std::vector<std::vector<SgfMetadata>> per_file(paths.size());
+    parallel_for(paths.size(), num_threads, [&](size_t i) {
+        auto add_invalid_entry = [&]() {
+            SgfMetadata metadata;
+            metadata.path = paths[i];
+            per_file[i].push_back(std::move(metadata));
+        };
+        // Directories open fine, but seeking to their end gives a bogus size.
+        std::error_code error;
+        if (!std::filesystem::is_regular_file(paths[i], error)) {
+            add_invalid_entry();
+            return;
+        }
+        std::ifstream file(paths[i], std::ios::binary);
+        if (!file.is_open()) {
+            add_invalid_entry();
+            return;
+        }
+        file.seekg(0, std::ios::end);
+        const std::streamoff size = file.tellg();
+        if (size < 0) {
+            add_invalid_entry();
+            return;
+        }
+        std::string content(static_cast<size_t>(size), '\0');
+        file.seekg(0, std::ios::beg);
+        file.read(content.data(), content.size());
+        if (!file) {
+            add_invalid_entry();
+            return;
+        }
+        scan_sgf_metadata(content, paths[i], per_file[i]);
+    });
+
+    std::vector<SgfMetadata> entries;
+    entries.reserve(paths.size());
+    for (auto& file_entries : per_file) {
+        std::move(file_entries.begin(), file_entries.end(), std::back_inserter(entries));
+    }
+    return entries;
+}
+
+std::vector<SgfMetadata> scan_sgf_directory(const std::string& directory, int num_threads) {
+    std::vector<std::string> paths;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension == ".sgf") {
+            paths.push_back(entry.path().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return scan_sgf_files(paths, num_threads);
+}
+
+void write_sgf_index(const std::string& index_path, const std::vector<SgfMetadata>& entries) {
+    std::ofstream out(index_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Could not open the file: " + index_path);
+    }
+
+    out.write(index_magic, sizeof(index_magic));
+    write_pod(out, index_version);
+    write_pod(out, static_cast<uint64_t>(entries.size()));
+    for (const SgfMetadata& metadata : entries) {
+        write_string<uint16_t>(out, metadata.path);
+        write_pod(out, metadata.offset);
+        write_pod(out, metadata.length);
+        write_pod(out, static_cast<int8_t>(metadata.board_size.x));
+        write_pod(out, static_cast<int8_t>(metadata.board_size.y));
+        write_pod(out, metadata.komi);
+        write_pod(out, static_cast<int16_t>(metadata.num_handicap_stones));
+        write_string<uint8_t>(out, metadata.rules);
+        write_string<uint8_t>(out, metadata.result);
+        write_pod(out, static_cast<int32_t>(metadata.start_turn_index));
+        write_pod(out, static_cast<int32_t>(metadata.num_moves));
+        write_pod(out, static_cast<uint8_t>(metadata.began_in_encore | metadata.is_valid << 1));
+    }
+    if (!out) {
+        throw std::runtime_error("Could not write the SGF index: " + index_path);
+    }
+}
+
+std::vector<SgfMetadata> read_sgf_index(const std::string& index_path) {
+    std::ifstream in(index_path, std::ios::binary);
+    if (!in.is_open()) {
+        throw std::runtime_error("Could not open the file: " + index_path);
+    }
+
+    char magic[sizeof(index_magic)];
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, index_magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not an SGF index: " + index_path);
+    }
+    if (read_pod<uint32_t>(in) != index_version) {
+        throw std::runtime_error("Unsupported SGF index version: " + index_path);
+    }
+
+    // Bound the count by the remaining bytes, so that a corrupt count fails instead of allocating.
+    const auto num_entries = read_pod<uint64_t>(in);
+    const auto entries_offset = static_cast<uint64_t>(in.tellg());
+    in.seekg(0, std::ios::end);
+    const auto file_size = static_cast<uint64_t>(in.tellg());
+    in.seekg(static_cast<std::streamoff>(entries_offset));
+    if (!in || num_entries > (file_size - entries_offset) / min_entry_size) {
+        throw std::runtime_error("Truncated SGF index: " + index_path);
+    }
+    std::vector<SgfMetadata> entries(num_entries);
+    for (SgfMetadata& metadata : entries) {
+        metadata.path = read_string<uint16_t>(in);
+        metadata.offset = read_pod<uint64_t>(in);
+        metadata.length = read_pod<uint64_t>(in);
+        metadata.board_size.x = read_pod<int8_t>(in);
+        metadata.board_size.y = read_pod<int8_t>(in);
+        metadata.komi = read_pod<float>(in);
+        metadata.num_handicap_stones = read_pod<int16_t>(in);
+        metadata.rules = read_string<uint8_t>(in);
+        metadata.result = read_string<uint8_t>(in);
+        metadata.start_turn_index = read_pod<int32_t>(in);
+        metadata.num_moves = read_pod<int32_t>(in);
+        const auto flags = read_pod<uint8_t>(in);
+        metadata.began_in_encore = flags & 1;
+        metadata.is_valid = (flags >> 1) & 1;
+        if (!in) {
+            throw std::runtime_error("Truncated SGF index: " + index_path);
+        }
+    }
+    return entries;
+}
+
+}  // namespace go_data_gen
@@ -0,0 +1,230 @@
+#include "go_data_gen/shared_position_ring.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include "go_data_gen/feature_expand.hpp"
+
+namespace go_data_gen {
+
+namespace {
+
+constexpr char ring_magic[8] = {'G', 'D', 'G', 'R', 'I', 'N', 'G', '1'};
+
+// Spins briefly, then sleeps, until `ready` returns true or the timeout expires.
+template <typename Func>
+bool wait_until(double timeout_seconds, Func&& ready) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0;; ++i) {
+        if (ready()) {
+            return true;
+        }
+        if (timeout_seconds >= 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                                  start)
+                                            .count() >= timeout_seconds) {
+            return false;
+        }
+        if (i < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+}  // namespace
+
+// Slot i holds position p = i + k * num_slots. Its sequence is p while the producer may write it,
+// p + 1 once it is published and p + num_slots once its consumer released it.
+struct SharedPositionRing::Header {
+    char magic[8];
+    uint32_t slot_size;
+    uint32_t num_slots;
+    alignas(64) std::atomic<uint64_t> read_index;
+    alignas(64) std::atomic<uint64_t> write_index;
+    std::atomic<uint32_t> closed;
+};
+
+SharedPositionRing::SharedPositionRing(const std::string& _name, int _num_slots)
+    : name{_name}, is_owner{true} {
+    // With a single slot, a published position would look free to the producer, since its
+    // sequence equals the next write index.
+    if (_num_slots < 2) {
+        throw std::runtime_error("The number of slots must be >= 2");
+    }
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("Could not create the shared memory object: " + name + ": " +
+                                 std::strerror(errno));
+    }
+    const size_t size = sizeof(Slot) * (1 + _num_slots);
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Could not size the shared memory object: " + name);
+    }
+    try {
+        map(fd, size);
+    } catch (...) {
+        shm_unlink(name.c_str());
+        throw;
+    }
+
+    // The mapping is zero-filled, so only the non-zero fields need to be set.
+    new (header) Header{};
+    for (int i = 0; i < _num_slots; ++i) {
+        new (&slots[i].sequence) std::atomic<uint64_t>(i);
+    }
+    header->slot_size = sizeof(Slot);
+    header->num_slots = _num_slots;
+    // Consumers check the magic last, after everything else is initialized.
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, ring_magic, sizeof(ring_magic));
+}
+
+SharedPositionRing::SharedPositionRing(const std::string& _name) : name{_name}, is_owner{false} {
+    const int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open the shared memory object: " + name + ": " +
+                                 std::strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < 3 * sizeof(Slot)) {
+        ::close(fd);
+        throw std::runtime_error("Not a position ring: " + name);
+    }
+    map(fd, st.st_size);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (std::memcmp(header->magic, ring_magic, sizeof(ring_magic)) != 0 ||
+        header->slot_size != sizeof(Slot) ||
+        sizeof(Slot) * (1 + static_cast<size_t>(header->num_slots)) != mapping_size) {
+        munmap(mapping, mapping_size);
+        throw std::runtime_error("Not a position ring, or built with different features: " + name);
+    }
+}
+
+SharedPositionRing::~SharedPositionRing() {
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+    }
+    if (is_owner) {
+        // Existing mappings of consumers stay valid.
+        shm_unlink(name.c_str());
+    }
+}
+
+void SharedPositionRing::map(int fd, size_t size) {
+    mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("Could not map the shared memory object: " + name);
+    }
+    mapping_size = size;
+    // The header occupies the first slot-sized block, so slots stay aligned.
+    static_assert(sizeof(Header) <= sizeof(Slot));
+    header = static_cast<Header*>(mapping);
+    slots = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + sizeof(Slot));
+}
+
+int SharedPositionRing::num_slots() const { return static_cast<int>(header->num_slots); }
+
+uint64_t SharedPositionRing::num_pending() const {
+    return header->write_index.load(std::memory_order_acquire) -
+           header->read_index.load(std::memory_order_acquire);
+}
+
+SharedPositionRing::Slot* SharedPositionRing::begin_write(double timeout_seconds) {
+    Slot& slot = slots[write_index % header->num_slots];
+    const bool is_free = wait_until(timeout_seconds, [&] {
+        return slot.sequence.load(std::memory_order_acquire) == write_index;
+    });
+    return is_free ? &slot : nullptr;
+}
+
+void SharedPositionRing::publish() {
+    slots[write_index % header->num_slots].sequence.store(write_index + 1,
+                                                          std::memory_order_release);
+    ++write_index;
+    header->write_index.store(write_index, std::memory_order_release);
+}
+
+bool SharedPositionRing::push(Board& board, Color to_play, const Move& move, float result,
+                              double timeout_seconds) {
+    Board::FeaturePlaneRows rows;
+    Board::FeatureVector scalars;
+    board.get_features(to_play, rows, scalars);
+    return push(rows, scalars, to_play, move, result, timeout_seconds);
+}
+
+bool SharedPositionRing::push(const Board::FeaturePlaneRows& rows,
+                              const Board::FeatureVector& scalars, Color to_play, const Move& move,
+                              float result, double timeout_seconds) {
+    Slot* slot = begin_write(timeout_seconds);
+    if (slot == nullptr) {
+        return false;
+    }
+    expand_rows_chw(&rows[0][0], Board::data_size, Board::data_size, Board::num_feature_planes,
+                    &slot->feature_planes[0][0][0]);
+    std::memcpy(slot->feature_scalars, scalars.data(), sizeof(slot->feature_scalars));
+    slot->move = move.is_pass ? -1 : move.coord.y * Board::max_board_size + move.coord.x;
+    slot->to_play = static_cast<int8_t>(to_play);
+    slot->result = result;
+    publish();
+    return true;
+}
+
+void SharedPositionRing::close() { header->closed.store(1, std::memory_order_release); }
+
+int SharedPositionRing::acquire(double timeout_seconds) {
+    const uint64_t num_slots = header->num_slots;
+    int index = -1;
+    wait_until(timeout_seconds, [&] {
+        uint64_t position = header->read_index.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[position % num_slots];
+            const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == position + 1) {
+                // Published. Claim it unless another consumer was faster.
+                if (header->read_index.compare_exchange_weak(position, position + 1,
+                                                             std::memory_order_relaxed)) {
+                    index = static_cast<int>(position % num_slots);
+                    return true;
+                }
+            } else if (sequence < position + 1) {
+                // Not yet published. Closing happens after the last publish, so an empty ring
+                // that is closed stays empty.
+                if (header->closed.load(std::memory_order_acquire) &&
+                    slot.sequence.load(std::memory_order_acquire) < position + 1) {
+                    return true;
+                }
+                return false;
+            } else {
+                // Already taken by another consumer. Retry from wait_until, which checks the
+                // timeout.
+                return false;
+            }
+        }
+    });
+    return index;
+}
+
+void SharedPositionRing::release(int index) {
+    if (index < 0 || index >= num_slots()) {
+        throw std::runtime_error("Slot index out of range: " + std::to_string(index));
+    }
+    // Sequence goes from position + 1 to position + num_slots, the next position of the slot.
+    Slot& slot = slots[index];
+    slot.sequence.store(slot.sequence.load(std::memory_order_relaxed) - 1 + header->num_slots,
+                        std::memory_order_release);
+}
+
+}  // namespace go_data_gen
@@ -1,5 +1,20 @@
 set(GDG_SOURCES
   ${CMAKE_CURRENT_LIST_DIR}/board.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/board_batch.cpp
   ${CMAKE_CURRENT_LIST_DIR}/board_print.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/board_serialize.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/bucketed_batcher.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/corpus_job.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/feature_cache.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/feature_expand.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/feature_server.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/feature_set.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/file_reader.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/game_file.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/incremental_featurizer.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/position_index.cpp
   ${CMAKE_CURRENT_LIST_DIR}/sgf.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/sgf_index.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/shared_position_ring.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/tar_reader.cpp
 )
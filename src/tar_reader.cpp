@@ -0,0 +1,220 @@
+#include "go_data_gen/tar_reader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef GDG_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+constexpr size_t block_size = 512;
+
+// Numeric header fields are octal, or base-256 if the high bit of the first byte is set.
+uint64_t parse_numeric_field(const char* field, size_t size) {
+    uint64_t value = 0;
+    if (static_cast<unsigned char>(field[0]) & 0x80) {
+        value = static_cast<unsigned char>(field[0]) & 0x7f;
+        for (size_t i = 1; i < size; ++i) {
+            value = (value << 8) | static_cast<unsigned char>(field[i]);
+        }
+        return value;
+    }
+    for (size_t i = 0; i < size && field[i] != '\0'; ++i) {
+        if (field[i] >= '0' && field[i] <= '7') {
+            value = value * 8 + (field[i] - '0');
+        }
+    }
+    return value;
+}
+
+bool header_checksum_matches(const char* header) {
+    // The checksum is computed with the checksum field itself treated as spaces.
+    static constexpr size_t checksum_offset = 148;
+    static constexpr size_t checksum_size = 8;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < block_size; ++i) {
+        const bool in_checksum = i >= checksum_offset && i < checksum_offset + checksum_size;
+        sum += in_checksum ? ' ' : static_cast<unsigned char>(header[i]);
+    }
+    return sum == parse_numeric_field(header + checksum_offset, checksum_size);
+}
+
+std::string field_to_string(const char* field, size_t size) {
+    return std::string(field, std::find(field, field + size, '\0'));
+}
+
+// Extracts the "path" record of a pax extended header, or returns an empty string.
+std::string pax_path(const std::string& records) {
+    size_t pos = 0;
+    while (pos < records.size()) {
+        const size_t space = records.find(' ', pos);
+        if (space == std::string::npos) {
+            break;
+        }
+        const size_t length = std::strtoull(records.c_str() + pos, nullptr, 10);
+        if (length == 0 || pos + length > records.size()) {
+            break;
+        }
+        // Record format: "<length> <key>=<value>\n"
+        const std::string record = records.substr(space + 1, pos + length - space - 2);
+        if (record.compare(0, 5, "path=") == 0) {
+            return record.substr(5);
+        }
+        pos += length;
+    }
+    return "";
+}
+
+}  // namespace
+
+namespace go_data_gen {
+
+class TarReader::Stream {
+public:
+    explicit Stream(const std::string& path) {
+#ifdef GDG_HAVE_ZLIB
+        // gzread also reads uncompressed files transparently.
+        file = gzopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            throw std::runtime_error("Could not open the file: " + path);
+        }
+        gzbuffer(file, 1 << 17);
+#else
+        file.open(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open the file: " + path);
+        }
+        if (file.peek() == 0x1f) {
+            throw std::runtime_error("Reading gzip archives requires building with zlib: " + path);
+        }
+#endif
+    }
+
+    ~Stream() {
+#ifdef GDG_HAVE_ZLIB
+        gzclose(file);
+#endif
+    }
+
+    // Returns the number of bytes read, which is less than `size` only at the end of the stream.
+    size_t read(char* data, size_t size) {
+#ifdef GDG_HAVE_ZLIB
+        size_t total = 0;
+        while (total < size) {
+            const unsigned chunk = static_cast<unsigned>(std::min<size_t>(size - total, 1u << 30));
+            const int num_read = gzread(file, data + total, chunk);
+            if (num_read < 0) {
+                int error;
+                throw std::runtime_error(std::string("Decompression failed: ") +
+                                         gzerror(file, &error));
+            }
+            if (num_read == 0) {
+                break;
+            }
+            total += num_read;
+        }
+        return total;
+#else
+        file.read(data, size);
+        return static_cast<size_t>(file.gcount());
+#endif
+    }
+
+private:
+#ifdef GDG_HAVE_ZLIB
+    gzFile file;
+#else
+    std::ifstream file;
+#endif
+};
+
+TarReader::TarReader(const std::string& _archive_path)
+    : stream{std::make_unique<Stream>(_archive_path)}, archive_path{_archive_path} {}
+
+TarReader::~TarReader() = default;
+
+bool TarReader::next(std::string& name, std::string& content) {
+    std::string long_name;
+    char header[block_size];
+    while (true) {
+        const size_t num_read = stream->read(header, block_size);
+        position += num_read;
+        if (num_read == 0) {
+            return false;
+        }
+        if (num_read < block_size) {
+            throw std::runtime_error("Truncated tar archive: " + archive_path);
+        }
+        // A zero block marks the end of the archive.
+        if (std::all_of(header, header + block_size, [](char c) { return c == '\0'; })) {
+            return false;
+        }
+        if (!header_checksum_matches(header)) {
+            throw std::runtime_error("Invalid tar header in " + archive_path);
+        }
+
+        const uint64_t size = parse_numeric_field(header + 124, 12);
+        const uint64_t padding = (block_size - size % block_size) % block_size;
+        const char type = header[156];
+
+        if (type == 'L' || type == 'x') {
+            // GNU long name or pax extended header for the next entry.
+            std::string data(size, '\0');
+            read_exactly(data.data(), size);
+            skip(padding);
+            if (type == 'L') {
+                long_name = data.c_str();
+            } else {
+                const std::string path = pax_path(data);
+                if (!path.empty()) {
+                    long_name = path;
+                }
+            }
+            continue;
+        }
+        if (type != '0' && type != '\0' && type != '7') {
+            // Directories, links and other special entries.
+            skip(size + padding);
+            long_name.clear();
+            continue;
+        }
+
+        if (!long_name.empty()) {
+            name = long_name;
+        } else {
+            // ustar splits long paths into a prefix and a name.
+            const std::string prefix = field_to_string(header + 345, 155);
+            name = field_to_string(header, 100);
+            if (std::memcmp(header + 257, "ustar", 5) == 0 && !prefix.empty()) {
+                name = prefix + "/" + name;
+            }
+        }
+        last_entry_offset = position;
+        content.resize(size);
+        read_exactly(content.data(), size);
+        skip(padding);
+        return true;
+    }
+}
+
+void TarReader::read_exactly(char* data, size_t size) {
+    if (stream->read(data, size) != size) {
+        throw std::runtime_error("Truncated tar archive: " + archive_path);
+    }
+    position += size;
+}
+
+void TarReader::skip(uint64_t size) {
+    char buffer[16 * block_size];
+    while (size > 0) {
+        const size_t chunk = static_cast<size_t>(std::min<uint64_t>(size, sizeof(buffer)));
+        read_exactly(buffer, chunk);
+        size -= chunk;
+    }
+}
+
+}  // namespace go_data_gen
@@ -0,0 +1,110 @@
+// Board::deserialize must reject malformed data with an exception, and boards that it accepts must
+// be safe to featurize.
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "go_data_gen/board.hpp"
+
+using namespace go_data_gen;
+
+namespace {
+
+int num_failures = 0;
+
+void check(bool condition, const char* message) {
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", message);
+        ++num_failures;
+    }
+}
+
+bool deserializes(const std::string& data) {
+    Board board;
+    try {
+        board.deserialize(data);
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    Board::FeaturePlaneRows rows;
+    Board::FeatureVector scalars;
+    board.get_features(Black, rows, scalars);
+    board.get_features(White, rows, scalars);
+    return true;
+}
+
+// Byte offsets of the header fields, see Board::serialize.
+constexpr size_t size_offset = 4 + 1 + 8;
+constexpr size_t handicap_offset = size_offset + 2 + 4 + 5;
+constexpr size_t first_player_to_pass_offset = handicap_offset + 4;
+constexpr size_t captures_offset = first_player_to_pass_offset + 1;
+constexpr size_t setup_stones_offset = captures_offset + 4;
+constexpr size_t stones_offset = setup_stones_offset + 4 + 8;
+
+template <typename T>
+std::string with_value(std::string data, size_t offset, T value) {
+    std::memcpy(data.data() + offset, &value, sizeof(T));
+    return data;
+}
+
+}  // namespace
+
+int main() {
+    Board board({9, 13}, 6.5f);
+    board.setup_move(Move{Black, false, {2, 2}});
+    board.play(Move{Black, false, {3, 3}});
+    board.play(Move{White, false, {5, 5}});
+    board.play(Move{Black, false, {3, 4}});
+    board.play(Move{White, true, {0, 0}});
+    const std::string data = board.serialize();
+    check(deserializes(data), "valid board");
+
+    for (size_t size = 0; size < data.size(); ++size) {
+        check(!deserializes(data.substr(0, size)), "truncated board");
+    }
+    check(!deserializes(data + '\0'), "trailing data");
+
+    // Every single-byte corruption is either rejected or yields a board that can be featurized.
+    for (size_t i = 0; i < data.size(); ++i) {
+        for (const int bits : {0x01, 0x80, 0xff}) {
+            std::string corrupted = data;
+            corrupted[i] ^= static_cast<char>(bits);
+            deserializes(corrupted);
+        }
+    }
+
+    check(!deserializes(with_value<uint8_t>(data, size_offset, 20)), "board size");
+    check(!deserializes(with_value<int32_t>(data, handicap_offset, -1)), "handicap stones");
+    check(!deserializes(with_value<uint8_t>(data, first_player_to_pass_offset, OffBoard)),
+          "first player to pass");
+    check(!deserializes(with_value<int32_t>(data, captures_offset, 1 << 30)), "captures");
+    check(!deserializes(with_value<int32_t>(data, setup_stones_offset, -5)), "setup stones");
+    // Point 0 is empty; 3 is not a color.
+    check(!deserializes(with_value<uint8_t>(data, stones_offset, 3)), "stone color");
+
+    // The history starts after the 2-bit stones and the move count.
+    const size_t history_offset = stones_offset + (9 * 13 + 3) / 4 + 4;
+    check(!deserializes(with_value(data, history_offset, PackedMove{Black, 0, 100, 100})),
+          "move outside of the board");
+    check(!deserializes(with_value(data, history_offset, PackedMove{Black, 0, 9, 0})),
+          "move outside of the board width");
+    check(!deserializes(with_value(data, history_offset, PackedMove{OffBoard, 0, 3, 3})),
+          "move color");
+    check(deserializes(with_value(data, history_offset, PackedMove{Black, 1, 0, 0})), "pass");
+
+    // A black stone surrounded by white stones has no liberties.
+    Board surrounded({5, 5});
+    surrounded.setup_move(Move{White, false, {1, 0}});
+    surrounded.setup_move(Move{White, false, {0, 1}});
+    std::string no_liberties = surrounded.serialize();
+    no_liberties[stones_offset] |= Black;
+    check(!deserializes(no_liberties), "group without liberties");
+
+    if (num_failures > 0) {
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}